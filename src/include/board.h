@@ -21,6 +21,7 @@
 
 #include "bitboard.h"
 #include "hashkey.h"
+#include "nnue.h"
 #include "psq_score.h"
 #include "types.h"
 
@@ -41,7 +42,11 @@ typedef struct boardstack_s
     bitboard_t kingBlockers[COLOR_NB];
     bitboard_t pinners[COLOR_NB];
     bitboard_t checkSquares[PIECETYPE_NB];
+    bool blockersValid;
+    bool checkSquaresValid;
     int repetition;
+    dirty_pieces_t dirtyPieces;
+    nnue_accumulator_t accumulator;
 } boardstack_t;
 
 // Struct representing the board
@@ -57,6 +62,9 @@ typedef struct board_s
     int ply;
     color_t sideToMove;
     scorepair_t psqScorePair;
+#ifdef INCREMENTAL_EVAL
+    bitboard_t pieceAttacks[SQUARE_NB];
+#endif
     boardstack_t *stack;
     void *worker;
     bool chess960;
@@ -70,17 +78,24 @@ void cyclic_init(void);
 // Returns the list of attacking pieces for a given square and occupancy.
 bitboard_t attackers_list(const board_t *board, square_t s, bitboard_t occupied);
 
+#ifdef INCREMENTAL_EVAL
+// Refreshes the cached attacks of the pieces on the given squares, and of all sliders whose
+// attacks go through them.
+void update_piece_attacks(board_t *board, bitboard_t changed);
+#endif
+
 // Helper for applying castling moves.
 void do_castling(board_t *board, color_t us, square_t kingFrom, square_t *kingTo,
     square_t *rookFrom, square_t *rookTo);
 
 // Applies a legal move to the board. This function needs information about whether
 // the move gives check or not, if this information is missing, call do_move() instead.
-void do_move_gc(board_t *board, move_t move, boardstack_t *stack, bool givesCheck);
+// The new state is stored in the stack frame following the current one.
+void do_move_gc(board_t *board, move_t move, bool givesCheck);
 
 // Applies a null move to the board. This function must not be called when the
 // side to move is in check.
-void do_null_move(board_t *board, boardstack_t *stack);
+void do_null_move(board_t *board);
 
 // Returns the FEN representation of the board.
 const char *board_fen(const board_t *board);
@@ -107,6 +122,10 @@ bool move_gives_check(const board_t *board, move_t move);
 // given threshold.
 bool see_greater_than(const board_t *board, move_t move, score_t threshold);
 
+// Returns the exact Static Exchange Evaluation score of the given move. For any threshold,
+// see_value(board, move) >= threshold if and only if see_greater_than(board, move, threshold).
+score_t see_value(const board_t *board, move_t move);
+
 // Initializes the board from the given FEN string.
 void set_board(board_t *board, char *fen, bool isChess960, boardstack_t *bstack);
 
@@ -116,8 +135,11 @@ void set_boardstack(board_t *board, boardstack_t *stack);
 // Sets a castling right from the given color and rook square.
 void set_castling(board_t *board, color_t color, square_t rookSquare);
 
-// Initializes checkers info (pinned pieces, checking squares, etc.).
-void set_check(board_t *board, boardstack_t *stack);
+// Initializes the King blockers and pinners of both colors.
+void set_blockers(const board_t *board, boardstack_t *stack);
+
+// Initializes the squares from which each piece type would give check to the opponent King.
+void set_check_squares(const board_t *board, boardstack_t *stack);
 
 // Returns the bitboard of all pieces preventing attacks on the given square.
 bitboard_t slider_blockers(
@@ -133,11 +155,12 @@ void undo_move(board_t *board, move_t move);
 // Reverts a null move.
 void undo_null_move(board_t *board);
 
-// Duplicates a board stack (including all the linked sub-nodes).
-boardstack_t *dup_boardstack(const boardstack_t *stack);
+// Returns the number of stack frames, up to the given one, needed for repetition detection.
+size_t boardstack_history(const boardstack_t *stack);
 
-// Frees a board stack (including all the linked sub-nodes).
-void free_boardstack(boardstack_t *stack);
+// Copies the last count frames up to the given stack into the given contiguous array, and
+// returns the copy of the given stack.
+boardstack_t *copy_boardstack(boardstack_t *frames, const boardstack_t *stack, size_t count);
 
 // Returns the piece on the given square.
 INLINED piece_t piece_on(const board_t *board, square_t square) { return (board->table[square]); }
@@ -190,6 +213,31 @@ INLINED bitboard_t get_king_square(const board_t *board, color_t color)
     return (bb_first_sq(piece_bb(board, color, KING)));
 }
 
+// Returns the pieces blocking slider attacks on the King of the given color. Blockers and pinners
+// are only computed on first access after a move.
+INLINED bitboard_t king_blockers(const board_t *board, color_t color)
+{
+    if (!board->stack->blockersValid) set_blockers(board, board->stack);
+
+    return (board->stack->kingBlockers[color]);
+}
+
+// Returns the sliders of the given color pinning pieces to the opponent King.
+INLINED bitboard_t pinners_bb(const board_t *board, color_t color)
+{
+    if (!board->stack->blockersValid) set_blockers(board, board->stack);
+
+    return (board->stack->pinners[color]);
+}
+
+// Returns the squares from which the given piece type would give check to the opponent King.
+INLINED bitboard_t check_squares(const board_t *board, piecetype_t pt)
+{
+    if (!board->stack->checkSquaresValid) set_check_squares(board, board->stack);
+
+    return (board->stack->checkSquares[pt]);
+}
+
 // Returns a bitboard of all pseudo-legal king moves for the given square.
 INLINED bitboard_t king_moves(square_t square) { return (PseudoMoves[KING][square]); }
 
@@ -233,6 +281,18 @@ INLINED bitboard_t piece_moves(piecetype_t piecetype, square_t square, bitboard_
     }
 }
 
+// Returns the attacks of the non-Pawn, non-King piece on the given square. These come from the
+// incrementally updated cache when it is enabled.
+INLINED bitboard_t piece_attacks(const board_t *board, piecetype_t piecetype, square_t square)
+{
+#ifdef INCREMENTAL_EVAL
+    (void)piecetype;
+    return (board->pieceAttacks[square]);
+#else
+    return (piece_moves(piecetype, square, occupancy_bb(board)));
+#endif
+}
+
 // Returns a bitboard of all pieces attacking the given square.
 INLINED bitboard_t attackers_to(const board_t *board, square_t square)
 {
@@ -294,10 +354,22 @@ INLINED void remove_piece(board_t *board, square_t square)
     board->psqScorePair -= PsqScore[piece][square];
 }
 
+// Records a piece change for the network update. SQ_NONE is used for the origin of added
+// pieces and the destination of removed pieces.
+INLINED void add_dirty_piece(boardstack_t *stack, piece_t piece, square_t from, square_t to)
+{
+    dirty_pieces_t *dp = &stack->dirtyPieces;
+
+    dp->piece[dp->count] = piece;
+    dp->from[dp->count] = from;
+    dp->to[dp->count] = to;
+    dp->count++;
+}
+
 // Applies a legal move to the board.
-INLINED void do_move(board_t *board, move_t move, boardstack_t *stack)
+INLINED void do_move(board_t *board, move_t move)
 {
-    do_move_gc(board, move, stack, move_gives_check(board, move));
+    do_move_gc(board, move, move_gives_check(board, move));
 }
 
 #endif // BOARD_H
@@ -20,6 +20,7 @@
 #define EVALUATE_H
 
 #include "board.h"
+#include "material.h"
 #include "pawns.h"
 
 #ifdef TUNE
@@ -103,10 +104,21 @@ extern evaltrace_t Trace;
 
 #endif
 
+// Type for cached static evals, holding the eval in the upper 16 bits and the
+// lower 48 bits of the key
+typedef uint64_t eval_entry_t;
+
 // Evaluates the position.
 score_t evaluate(const board_t *board);
 
+// Evaluates the position, probing the worker's eval cache first.
+score_t evaluate_cached(const board_t *board);
+
+// Evaluates the position with the loaded network.
+score_t nnue_evaluate(const board_t *board);
+
 // Returns the scaled value of the endgame score.
-score_t scale_endgame(const board_t *board, const pawn_entry_t *pe, score_t eg);
+score_t scale_endgame(
+    const board_t *board, const pawn_entry_t *pe, const material_entry_t *me, score_t eg);
 
 #endif
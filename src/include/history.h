@@ -26,7 +26,8 @@ enum
 {
     HistoryMaxScore = 8192,
     HistoryScale = 2,
-    HistoryResolution = HistoryMaxScore * HistoryScale
+    HistoryResolution = HistoryMaxScore * HistoryScale,
+    HistoryAgingShift = 1
 };
 
 typedef int16_t butterfly_history_t[COLOR_NB][SQUARE_NB * SQUARE_NB];
@@ -35,6 +36,10 @@ typedef int16_t capture_history_t[PIECE_NB][SQUARE_NB][PIECETYPE_NB];
 typedef piece_history_t continuation_history_t[PIECE_NB][SQUARE_NB];
 typedef move_t countermove_history_t[PIECE_NB][SQUARE_NB];
 
+// Scales down all scores of the given history table, which holds count entries. This is used
+// between searches, so that move ordering knowledge carries over to the next search.
+void age_history(int16_t *table, size_t count);
+
 // Returns the history bonus for the given depth.
 INLINED int history_bonus(int depth) { return (depth <= 11 ? 14 * depth * depth : 2000); }
 
@@ -0,0 +1,54 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "board.h"
+#include "endgame.h"
+
+// Struct for material eval data
+typedef struct material_entry_s
+{
+    hashkey_t key;
+    const endgame_entry_t *endgame;
+    color_t kxkSide;
+    int phase;
+    int scaleFactor[COLOR_NB];
+    int defaultFactor[COLOR_NB];
+    bool ocbCandidate;
+    bool rookEndgame[COLOR_NB];
+} material_entry_t;
+
+enum
+{
+    MaterialTableSize = 1 << 13,
+    ScaleUnknown = -1
+};
+
+// Probes the material hash table for the given position. The entry holds:
+// - the specialized endgame for the material configuration, if any;
+// - the side with a lone King vs mating material (COLOR_NB if none);
+// - the game phase;
+// - for each side considered as the strong one, the endgame scale factor if it only depends on
+//   material (ScaleUnknown otherwise), the scale factor used if no special endgame is detected,
+//   and whether the position can be a drawish Rook endgame;
+// - whether the position can be an opposite-colored Bishops endgame.
+material_entry_t *material_probe(const board_t *board);
+
+#endif
@@ -28,6 +28,7 @@ typedef struct extmove_s
 {
     move_t move;
     score_t score;
+    score_t see;
 } extmove_t;
 
 // Structure for holding a list of moves
@@ -59,6 +60,18 @@ extmove_t *generate_captures(extmove_t *movelist, const board_t *board, bool inQ
 // in the given movelist.
 extmove_t *generate_quiet(extmove_t *movelist, const board_t *board);
 
+// Generates all legal captures/queen promotions for the given board and stores them in the given
+// movelist.
+extmove_t *generate_legal_captures(extmove_t *movelist, const board_t *board, bool inQsearch);
+
+// Generates all legal non-captures/non-queen promotions for the given board and stores them in the
+// given movelist.
+extmove_t *generate_legal_quiet(extmove_t *movelist, const board_t *board);
+
+// Generates all legal moves for the given board (only for in-check positions) and stores them in
+// the given movelist.
+extmove_t *generate_legal_evasions(extmove_t *movelist, const board_t *board);
+
 // Places the move with the highest score in the first position of the movelist.
 void place_top_move(extmove_t *begin, extmove_t *end);
 
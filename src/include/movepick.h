@@ -54,14 +54,25 @@ typedef struct movepick_s
     move_t counter;
     const board_t *board;
     const worker_t *worker;
-    piece_history_t *pieceHistory[2];
+    piece_history_t *pieceHistory[ContinuationPlies];
+    score_t see;
 } movepick_t;
 
 // Initializes the move picker.
 void movepick_init(movepick_t *mp, bool inQsearch, const board_t *board, const worker_t *worker,
     move_t ttMove, searchstack_t *ss);
 
-// Returns the next move in the move picker.
+// Returns the next legal move in the move picker.
 move_t movepick_next_move(movepick_t *mp, bool skipQuiets);
 
+// Checks if the last move returned by the move picker has a SEE score greater than or equal to the
+// given threshold, using the SEE score computed by the move picker when available.
+INLINED bool movepick_see_ge(const movepick_t *mp, move_t move, score_t threshold)
+{
+    if (mp->see != NO_SCORE) return (mp->see >= threshold);
+
+    STATS_ADD(get_worker(mp->board), StatSeeCall);
+    return (see_greater_than(mp->board, move, threshold));
+}
+
 #endif
@@ -0,0 +1,62 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// The network is a 768 -> 2x256 -> 1 perceptron. The inputs are the piece/square
+// pairs seen from each side's perspective, and the hidden layer is kept
+// incrementally updated on the board stack.
+
+#define NNUE_INPUTS (2 * 6 * SQUARE_NB)
+#define NNUE_HIDDEN 256
+
+// Max number of piece changes for a single move (a capture-promotion moves the
+// Pawn, removes the captured piece, then swaps the Pawn for the new piece).
+#define DIRTY_PIECES_MAX 4
+
+// Struct for the hidden layer of both perspectives
+typedef struct nnue_accumulator_s
+{
+    int16_t values[COLOR_NB][NNUE_HIDDEN];
+    bool computed;
+} nnue_accumulator_t;
+
+// Struct for the piece changes applied by a move
+typedef struct dirty_pieces_s
+{
+    int count;
+    piece_t piece[DIRTY_PIECES_MAX];
+    square_t from[DIRTY_PIECES_MAX];
+    square_t to[DIRTY_PIECES_MAX];
+} dirty_pieces_t;
+
+extern bool NnueLoaded;
+
+// Loads the network from the given file, and enables it for evaluation. Returns NULL on
+// success, or a description of the error.
+const char *nnue_load(const char *filename);
+
+// Disables the network, falling back to the classical evaluation.
+void nnue_unload(void);
+
+#endif
@@ -0,0 +1,50 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include "types.h"
+#include <stddef.h>
+
+// Enum for the worker thread binding policies
+typedef enum thread_binding_e
+{
+    BindNone,
+    BindNode,
+    BindCore,
+    BINDING_NB
+} thread_binding_t;
+
+extern const char *const ThreadBindingNames[BINDING_NB + 1];
+
+// Returns the mask of online NUMA nodes (only the first 64 nodes are considered).
+unsigned long numa_online_mask(void);
+
+// Allocates zeroed memory which isn't touched yet, so that its pages get placed on the NUMA node
+// of the first thread writing to them. Returns NULL on failure.
+void *numa_alloc(size_t size);
+
+// Frees memory allocated with numa_alloc().
+void numa_free(void *ptr, size_t size);
+
+// Binds the calling thread to a NUMA node or a core, depending on the given policy, and on the
+// index of the worker it runs. Returns the bound node or core, or -1 if no binding was done.
+int numa_bind_thread(thread_binding_t binding, size_t idx);
+
+#endif // NUMA_H
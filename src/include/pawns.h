@@ -30,14 +30,15 @@ typedef struct pawn_entry_s
     bitboard_t attacks2[COLOR_NB];
     bitboard_t passed[COLOR_NB];
     scorepair_t value;
+    square_t kingSquare[COLOR_NB];
+    scorepair_t kingValue;
 } pawn_entry_t;
 
-enum
-{
-    PawnTableSize = 1 << 15
-};
-
 // Probes the pawn hash table for the given position.
 pawn_entry_t *pawn_probe(const board_t *board);
 
+// Returns the King-dependent Pawn structure terms (Passed Pawn proximity to both Kings) for the
+// given entry, using the cached value if the King squares didn't change since the last call.
+scorepair_t pawn_king_value(const board_t *board, pawn_entry_t *entry);
+
 #endif
@@ -0,0 +1,42 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "worker.h"
+
+// Struct for a perft hash entry. The key is xor-ed with the data, so that torn
+// writes from concurrent workers are detected on probe.
+typedef struct perft_entry_s
+{
+    hashkey_t key;
+    uint64_t data;
+} perft_entry_t;
+
+// Counts the leaf nodes of the legal move tree at the given depth.
+uint64_t perft(board_t *board, unsigned int depth);
+
+// Runs the perft requested in the search params from the main worker, splitting the root moves
+// among all workers, and prints the results.
+void perft_main(worker_t *worker);
+
+// Counts the leaf nodes for root moves until all of them have been handed out.
+void perft_worker(worker_t *worker);
+
+#endif
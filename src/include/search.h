@@ -42,9 +42,19 @@ extern int Pruning[2][7];
 
 enum
 {
-    MAX_PLIES = 240
+    MAX_PLIES = 240,
+
+    // Number of previous plies whose continuation histories are used for
+    // quiet move ordering, and number of search stack entries needed below
+    // the root to look them up.
+    ContinuationPlies = 4,
+    RootStackOffset = 6
 };
 
+// Returns the distance to the previous ply used by the given continuation
+// history index (1, 2, 4 and 6).
+INLINED int continuation_ply(int index) { return (index < 2 ? index + 1 : index * 2); }
+
 // Initializes the search tables.
 void init_search_tables(void);
 
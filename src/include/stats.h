@@ -0,0 +1,83 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "types.h"
+#include <string.h>
+
+#ifdef STATS
+
+// Enum for the search statistics counters
+typedef enum stat_e
+{
+    StatTTCutoff,
+    StatRazoring,
+    StatFutilityNode,
+    StatNullMoveTry,
+    StatNullMoveCutoff,
+    StatLateMovePruning,
+    StatFutilityMove,
+    StatSeePruning,
+    StatSeeCall,
+    StatLmrSearch,
+    StatLmrResearch,
+    StatSingularTry,
+    StatSingularExtension,
+    StatMultiCut,
+    StatFailHigh,
+    StatFailHighFirst,
+    STAT_NB
+} stat_t;
+
+// Struct for the search statistics of a worker
+typedef struct search_stats_s
+{
+    uint64_t counters[STAT_NB];
+    uint64_t nodes;
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t evalProbes;
+    uint64_t evalHits;
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+} search_stats_t;
+
+// Global search statistics, merged from all workers at the end of each search
+extern search_stats_t SearchStats;
+
+#define STATS_ADD(worker, stat) ((worker)->stats.counters[stat]++)
+#define STATS_RESET(worker) memset(&(worker)->stats, 0, sizeof(search_stats_t))
+#define STATS_MERGE(wpool) wpool_merge_stats(wpool)
+
+// Resets the global search statistics.
+void stats_reset(void);
+
+// Prints the global search statistics.
+void stats_print(void);
+
+#else
+
+#define STATS_ADD(worker, stat) ((void)0)
+#define STATS_RESET(worker) ((void)0)
+#define STATS_MERGE(wpool) ((void)0)
+
+#endif
+
+#endif // STATS_H
@@ -24,7 +24,7 @@
 #include <sys/timeb.h>
 #include <time.h>
 
-// Returns the current time in milliseconds.
+// Returns the current time in milliseconds, from a monotonic clock.
 INLINED clock_t chess_clock(void)
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -35,7 +35,7 @@ INLINED clock_t chess_clock(void)
 #else
     struct timespec tp;
 
-    clock_gettime(CLOCK_REALTIME, &tp);
+    clock_gettime(CLOCK_MONOTONIC, &tp);
     return ((clock_t)tp.tv_sec * 1000 + tp.tv_nsec / 1000000);
 #endif
 }
@@ -95,8 +95,20 @@ void timeman_init(const board_t *board, timeman_t *tm, goparams_t *params, clock
 // Updates the time management based on the current bestmove and score.
 void timeman_update(timeman_t *tm, const board_t *board, move_t bestmove, score_t score);
 
-// Checks time usage periodically.
-void check_time(void);
+// Period of the timer thread in milliseconds
+enum
+{
+    TimerPeriod = 5
+};
+
+// Starts the timer thread, which stops the search when its time or node limit is reached.
+void timer_start(void);
+
+// Waits for the timer thread to exit after the search has been stopped.
+void timer_stop(void);
+
+// Checks the node limit periodically for single-threaded searches.
+void check_node_limit(void);
 
 // Checks if we can safely stop the search.
 INLINED bool timeman_can_stop_search(timeman_t *tm, clock_t cur)
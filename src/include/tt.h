@@ -23,15 +23,75 @@
 #include "types.h"
 #include <string.h>
 
-// Struct for TT entry
+#ifdef TT_COMPACT
+
+// Type for the part of the hashkey stored in TT entries
+typedef uint16_t ttkey_t;
+
+// Struct for compact TT entry. Only 16 bits of the hashkey are stored, the
+// cluster index being computed from the highest bits of the hashkey.
+typedef struct __attribute__((packed)) tt_entry_s
+{
+    ttkey_t key;
+    union
+    {
+        struct
+        {
+            score_t score;
+            score_t eval;
+            uint8_t depth;
+            uint8_t genbound;
+            uint16_t bestmove;
+        };
+        uint64_t data;
+    };
+} tt_entry_t;
+
+enum
+{
+    ClusterSize = 3
+};
+
+// Struct for TT entry cluster, padded to half a cache line
+typedef struct cluster_s
+{
+    tt_entry_t clEntry[ClusterSize];
+    char padding[2];
+} cluster_t;
+
+// Returns the part of the hashkey stored in TT entries. We skip the lowest
+// 16 bits, since excluded moves are mixed in bits 16-31 of the search key.
+INLINED ttkey_t tt_key(hashkey_t k) { return ((ttkey_t)(k >> 16)); }
+
+// Returns the check value XOR-ed with the stored key for the given entry data.
+INLINED ttkey_t tt_data_check(uint64_t data)
+{
+    return ((ttkey_t)(data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48)));
+}
+
+#else
+
+// Type for the part of the hashkey stored in TT entries
+typedef hashkey_t ttkey_t;
+
+// Struct for TT entry. The key is stored XOR-ed with the packed entry data, so
+// that entries torn by concurrent writes from other threads fail the key check
+// on probe instead of returning corrupted data.
 typedef struct tt_entry_s
 {
-    hashkey_t key;
-    score_t score;
-    score_t eval;
-    uint8_t depth;
-    uint8_t genbound;
-    uint16_t bestmove;
+    ttkey_t key;
+    union
+    {
+        struct
+        {
+            score_t score;
+            score_t eval;
+            uint8_t depth;
+            uint8_t genbound;
+            uint16_t bestmove;
+        };
+        uint64_t data;
+    };
 } tt_entry_t;
 
 enum
@@ -45,12 +105,35 @@ typedef struct cluster_s
     tt_entry_t clEntry[ClusterSize];
 } cluster_t;
 
+// Returns the part of the hashkey stored in TT entries.
+INLINED ttkey_t tt_key(hashkey_t k) { return (k); }
+
+// Returns the check value XOR-ed with the stored key for the given entry data.
+INLINED ttkey_t tt_data_check(uint64_t data) { return (data); }
+
+#endif
+
+// Enum for the kind of memory backing the TT
+typedef enum tt_alloc_e
+{
+    TTAllocNone,
+    TTAllocDefault,
+    TTAllocTransparentHuge,
+    TTAllocHugetlb,
+    TTAllocMapped
+} tt_alloc_t;
+
 // Struct for the transposition table
 typedef struct transposition_s
 {
     size_t clusterCount;
     cluster_t *table;
     uint8_t generation;
+    ttkey_t epochKey;
+    uint64_t epoch;
+    tt_alloc_t allocMode;
+    size_t allocSize;
+    int numaNodes;
 } transposition_t;
 
 // Global transposition table
@@ -65,6 +148,12 @@ INLINED tt_entry_t *tt_entry_at(hashkey_t k)
 // Updates the TT generation.
 INLINED void tt_clear(void) { TT.generation += 4; }
 
+// Returns the key salt used for entries written during the given TT epoch.
+INLINED ttkey_t tt_epoch_key(uint64_t epoch)
+{
+    return ((ttkey_t)(epoch * 0x9E3779B97F4A7C15ull));
+}
+
 // Converts a score to a TT score.
 INLINED score_t score_to_tt(score_t s, int plies)
 {
@@ -80,8 +169,24 @@ INLINED score_t score_from_tt(score_t s, int plies)
 // Resets the TT contents.
 void tt_bzero(size_t threadCount);
 
-// Probes the TT for the given hashkey.
-tt_entry_t *tt_probe(hashkey_t key, bool *found);
+// Invalidates all TT entries in constant time, by starting a new TT epoch.
+void tt_new_epoch(void);
+
+// Returns the real key of the given entry.
+INLINED ttkey_t tt_entry_key(const tt_entry_t *entry)
+{
+    return (entry->key ^ tt_data_check(entry->data) ^ TT.epochKey);
+}
+
+// Returns the key to store in an entry for the given real key and entry data.
+INLINED ttkey_t tt_stored_key(ttkey_t key, uint64_t data)
+{
+    return (key ^ tt_data_check(data) ^ TT.epochKey);
+}
+
+// Probes the TT for the given hashkey. A consistent copy of the entry's data (with the decoded
+// key) is stored in ttData, and the returned pointer is only meant to be passed to tt_save().
+tt_entry_t *tt_probe(hashkey_t key, bool *found, tt_entry_t *ttData);
 
 // Saves the given entry in the TT.
 void tt_save(tt_entry_t *entry, hashkey_t k, score_t s, score_t e, int d, int b, move_t m);
@@ -89,7 +194,19 @@ void tt_save(tt_entry_t *entry, hashkey_t k, score_t s, score_t e, int d, int b,
 // Returns the filling rate of the TT (per mil).
 int tt_hashfull(void);
 
-// Resizes the TT.
-void tt_resize(size_t mbsize);
+// Resizes the TT, keeping as many entries of the old table as possible. Returns the number of
+// entries kept.
+size_t tt_resize(size_t mbsize);
+
+// Saves the TT contents to the given file, using threadCount threads for writing. Returns NULL on
+// success, or a description of the error.
+const char *tt_save_file(const char *filename, size_t threadCount);
+
+// Replaces the TT with the contents of the given file, mapping it in memory when possible.
+// Returns NULL on success, or a description of the error.
+const char *tt_load_file(const char *filename);
+
+// Returns a description of the memory backing the TT, for UCI info strings.
+const char *tt_alloc_info(void);
 
 #endif // TT_H
@@ -19,6 +19,7 @@
 #ifndef UCI_H
 #define UCI_H
 
+#include "numa.h"
 #include "worker.h"
 #include <inttypes.h>
 #include <pthread.h>
@@ -38,14 +39,29 @@ typedef uint32_t info_t;
 #define MAX_HASH 2048
 #endif
 
+// Enum for the iterative deepening schedule of helper workers
+typedef enum helper_schedule_e
+{
+    ScheduleUniform,
+    ScheduleSkip,
+    ScheduleOffset,
+    SCHEDULE_NB
+} helper_schedule_t;
+
+extern const char *const HelperScheduleNames[SCHEDULE_NB + 1];
+
 typedef struct ucioptions_s
 {
     long threads;
     long hash;
+    long evalCache;
+    long pawnHash;
     long moveOverhead;
     long multiPv;
     bool chess960;
     bool ponder;
+    helper_schedule_t helperSchedule;
+    thread_binding_t threadBinding;
 } ucioptions_t;
 
 extern pthread_attr_t WorkerSettings;
@@ -69,10 +85,13 @@ void uci_d(const char *args);
 void uci_debug(const char *args);
 void uci_go(const char *args);
 void uci_isready(const char *args);
+void uci_loadhash(const char *args);
 void uci_ponderhit(const char *args);
 void uci_position(const char *args);
 void uci_quit(const char *args);
+void uci_savehash(const char *args);
 void uci_setoption(const char *args);
+void uci_stats(const char *args);
 void uci_stop(const char *args);
 void uci_uci(const char *args);
 void uci_ucinewgame(const char *args);
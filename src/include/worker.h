@@ -20,10 +20,14 @@
 #define WORKER_H
 
 #include "board.h"
+#include "evaluate.h"
 #include "history.h"
+#include "material.h"
 #include "pawns.h"
+#include "stats.h"
 #include "uci.h"
 #include <pthread.h>
+#include <stdatomic.h>
 #include <time.h>
 
 // Struct for search params.
@@ -40,6 +44,7 @@ typedef struct goparams_s
     int mate;
     int infinite;
     int perft;
+    int divide;
     int ponder;
     clock_t movetime;
 } goparams_t;
@@ -62,21 +67,47 @@ root_move_t *find_root_move(root_move_t *begin, root_move_t *end, move_t move);
 void print_pv(
     const board_t *board, root_move_t *rootMove, int multiPv, int depth, clock_t time, int bound);
 
+// Number of plies before the root preallocated in each worker's board history
+enum
+{
+    DefaultHistorySize = 128
+};
+
 // Struct for worker thread data.
 
 typedef struct worker_s
 {
     board_t board;
-    boardstack_t *stack;
+    boardstack_t *stackList;
+    size_t stackListSize;
     butterfly_history_t bfHistory;
     continuation_history_t ctHistory;
     countermove_history_t cmHistory;
     capture_history_t capHistory;
     pawn_entry_t *pawnTable;
+    size_t pawnTableSize;
+    material_entry_t *materialTable;
+    eval_entry_t *evalCache;
+    size_t evalCacheSize;
 
     int seldepth;
     int verifPlies;
-    _Atomic uint64_t nodes;
+
+    // The node counter is only written by the worker's thread, and is kept on its own cache
+    // line so that the reads of other threads don't bounce the surrounding fields.
+    _Alignas(64) _Atomic uint64_t nodes;
+    char nodesPadding[64 - sizeof(uint64_t)];
+
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t evalProbes;
+    uint64_t evalHits;
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+
+#ifdef STATS
+    search_stats_t stats;
+#endif
 
     root_move_t *rootMoves;
     size_t rootCount;
@@ -94,6 +125,15 @@ INLINED worker_t *get_worker(const board_t *board) { return (board->worker); }
 
 INLINED score_t draw_score(const worker_t *worker) { return (worker->nodes & 2) - 1; }
 
+// Increments the node counter of the worker. Since only the worker's thread writes to it, this
+// is a plain increment, the relaxed atomic accesses only keep concurrent reads well-defined.
+INLINED void worker_add_node(worker_t *worker)
+{
+    uint64_t nodes = atomic_load_explicit(&worker->nodes, memory_order_relaxed);
+
+    atomic_store_explicit(&worker->nodes, nodes + 1, memory_order_relaxed);
+}
+
 void worker_init(worker_t *worker, size_t idx);
 void worker_destroy(worker_t *worker);
 void worker_search(worker_t *worker);
@@ -111,6 +151,10 @@ typedef struct worker_pool_s
     _Atomic bool ponder;
     _Atomic bool stop;
 
+    // Used to wake up the main worker when waiting for a stop or ponderhit.
+    pthread_mutex_t mutex;
+    pthread_cond_t condVar;
+
     worker_t **workerList;
 } worker_pool_t;
 
@@ -124,6 +168,19 @@ void wpool_start_search(
     worker_pool_t *wpool, const board_t *rootBoard, const goparams_t *searchParams);
 void wpool_start_workers(worker_pool_t *wpool);
 void wpool_wait_search_end(worker_pool_t *wpool);
+void wpool_stop(worker_pool_t *wpool);
+void wpool_ponderhit(worker_pool_t *wpool);
+void wpool_wait_stop(worker_pool_t *wpool, const goparams_t *searchParams);
 uint64_t wpool_get_total_nodes(worker_pool_t *wpool);
+uint64_t wpool_get_total_tt_probes(worker_pool_t *wpool);
+uint64_t wpool_get_total_tt_hits(worker_pool_t *wpool);
+uint64_t wpool_get_total_eval_probes(worker_pool_t *wpool);
+uint64_t wpool_get_total_eval_hits(worker_pool_t *wpool);
+uint64_t wpool_get_total_pawn_probes(worker_pool_t *wpool);
+uint64_t wpool_get_total_pawn_hits(worker_pool_t *wpool);
+
+#ifdef STATS
+void wpool_merge_stats(worker_pool_t *wpool);
+#endif
 
 #endif
\ No newline at end of file
@@ -17,96 +17,621 @@
 */
 
 #include "board.h"
+#include "movelist.h"
 #include "timeman.h"
+#include "tt.h"
+#include "uci.h"
+#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-void uci_bench(const char *args)
+// List of positions to search
+
+const char *BenchPositions[] = {
+    "fen r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
+    "fen 4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
+    "fen r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
+    "fen 6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
+    "fen 8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+    "fen 7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
+    "fen r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
+    "fen 3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
+    "fen 2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
+    "fen 4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
+    "fen 2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
+    "fen 1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
+    "fen r3kbbr/pp1n1p1P/3ppnp1/q5N1/1P1pP3/P1N1B3/2P1QP2/R3KB1R b KQkq b3 0 17",
+    "fen 8/6pk/2b1Rp2/3r4/1R1B2PP/P5K1/8/2r5 b - - 16 42",
+    "fen 1r4k1/4ppb1/2n1b1qp/pB4p1/1n1BP1P1/7P/2PNQPK1/3RN3 w - - 8 29",
+    "fen 8/p2B4/PkP5/4p1pK/4Pb1p/5P2/8/8 w - - 29 68",
+    "fen 3r4/ppq1ppkp/4bnp1/2pN4/2P1P3/1P4P1/PQ3PBP/R4K2 b - - 2 20",
+    "fen 5rr1/4n2k/4q2P/P1P2n2/3B1p2/4pP2/2N1P3/1RR1K2Q w - - 1 49",
+    "fen 1r5k/2pq2p1/3p3p/p1pP4/4QP2/PP1R3P/6PK/8 w - - 1 51",
+    "fen q5k1/5ppp/1r3bn1/1B6/P1N2P2/BQ2P1P1/5K1P/8 b - - 2 34",
+    "fen r1b2k1r/5n2/p4q2/1ppn1Pp1/3pp1p1/NP2P3/P1PPBK2/1RQN2R1 w - - 0 22",
+    "fen r1bqk2r/pppp1ppp/5n2/4b3/4P3/P1N5/1PP2PPP/R1BQKB1R w KQkq - 0 5",
+    "fen r1bqr1k1/pp1p1ppp/2p5/8/3N1Q2/P2BB3/1PP2PPP/R3K2n b Q - 1 12",
+    "fen r1bq2k1/p4r1p/1pp2pp1/3p4/1P1B3Q/P2B1N2/2P3PP/4R1K1 b - - 2 19",
+    "fen r4qk1/6r1/1p4p1/2ppBbN1/1p5Q/P7/2P3PP/5RK1 w - - 2 25",
+    "fen r7/6k1/1p6/2pp1p2/7Q/8/p1P2K1P/8 w - - 0 32",
+    "fen r3k2r/ppp1pp1p/2nqb1pn/3p4/4P3/2PP4/PP1NBPPP/R2QK1NR w KQkq - 1 5",
+    "fen 3r1rk1/1pp1pn1p/p1n1q1p1/3p4/Q3P3/2P5/PP1NBPPP/4RRK1 w - - 0 12",
+    "fen 5rk1/1pp1pn1p/p3Brp1/8/1n6/5N2/PP3PPP/2R2RK1 w - - 2 20",
+    "fen 8/1p2pk1p/p1p1r1p1/3n4/8/5R2/PP3PPP/4R1K1 b - - 3 27",
+    "fen 8/4pk2/1p1r2p1/p1p4p/Pn5P/3R4/1P3PP1/4RK2 w - - 1 33",
+    "fen 8/5k2/1pnrp1p1/p1p4p/P6P/4R1PK/1P3P2/4R3 b - - 1 38",
+    "fen 8/8/1p1kp1p1/p1pr1n1p/P6P/1R4P1/1P3PK1/1R6 b - - 15 45",
+    "fen 8/8/1p1k2p1/p1prp2p/P2n3P/6P1/1P1R1PK1/4R3 b - - 5 49",
+    "fen 8/8/1p4p1/p1p2k1p/P2npP1P/4K1P1/1P6/3R4 w - - 6 54",
+    "fen 8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/6R1 b - - 6 59",
+    "fen 8/5k2/1p4p1/p1pK3p/P2n1P1P/6P1/1P6/4R3 b - - 14 63",
+    "fen 8/1R6/1p1K1kp1/p6p/P1p2P1P/6P1/1Pn5/8 w - - 0 67",
+    "fen 1rb1rn1k/p3q1bp/2p3p1/2p1p3/2P1P2N/PP1RQNP1/1B3P2/4R1K1 b - - 4 23",
+    "fen 4rrk1/pp1n1pp1/q5p1/P1pP4/2n3P1/7P/1P3PB1/R1BQ1RK1 w - - 3 22",
+    "fen r2qr1k1/pb1nbppp/1pn1p3/2ppP3/3P4/2PB1NN1/PP3PPP/R1BQR1K1 w - - 4 12",
+    "fen 2r2k2/8/4P1R1/1p6/8/P4K1N/7b/2B5 b - - 0 55",
+    "fen 6k1/5pp1/8/2bKP2P/2P5/p4PNb/B7/8 b - - 1 44",
+    "fen 2rqr1k1/1p3p1p/p2p2p1/P1nPb3/2B1P3/5P2/1PQ2NPP/R1R4K w - - 3 25",
+    "fen r1b2rk1/p1q1ppbp/6p1/2Q5/8/4BP2/PPP3PP/2KR1B1R b - - 2 14",
+    "fen 6r1/5k2/p1b1r2p/1pB1p1p1/1Pp3PP/2P1R1K1/2P2P2/3R4 w - - 1 36",
+    "fen rnbqkb1r/pppppppp/5n2/8/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
+    "fen 2rr2k1/1p4bp/p1q1p1p1/4Pp1n/2PB4/1PN3P1/P3Q2P/2RR2K1 w - f6 0 20",
+    "fen 3br1k1/p1pn3p/1p3n2/5pNq/2P1p3/1PN3PP/P2Q1PB1/4R1K1 w - - 0 23",
+    "fen 2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93", NULL};
+
+// Struct for the results of a bench run
+typedef struct bench_result_s
 {
-    // If bench depth isn't given, use default depth of 13.
-
-    if (!args || !atoi(args)) args = "13";
-
-    // List of positions to search
-
-    const char *positions[] = {
-        "fen r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
-        "fen 4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
-        "fen r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
-        "fen 6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
-        "fen 8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
-        "fen 7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
-        "fen r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
-        "fen 3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
-        "fen 2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
-        "fen 4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
-        "fen 2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
-        "fen 1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
-        "fen r3kbbr/pp1n1p1P/3ppnp1/q5N1/1P1pP3/P1N1B3/2P1QP2/R3KB1R b KQkq b3 0 17",
-        "fen 8/6pk/2b1Rp2/3r4/1R1B2PP/P5K1/8/2r5 b - - 16 42",
-        "fen 1r4k1/4ppb1/2n1b1qp/pB4p1/1n1BP1P1/7P/2PNQPK1/3RN3 w - - 8 29",
-        "fen 8/p2B4/PkP5/4p1pK/4Pb1p/5P2/8/8 w - - 29 68",
-        "fen 3r4/ppq1ppkp/4bnp1/2pN4/2P1P3/1P4P1/PQ3PBP/R4K2 b - - 2 20",
-        "fen 5rr1/4n2k/4q2P/P1P2n2/3B1p2/4pP2/2N1P3/1RR1K2Q w - - 1 49",
-        "fen 1r5k/2pq2p1/3p3p/p1pP4/4QP2/PP1R3P/6PK/8 w - - 1 51",
-        "fen q5k1/5ppp/1r3bn1/1B6/P1N2P2/BQ2P1P1/5K1P/8 b - - 2 34",
-        "fen r1b2k1r/5n2/p4q2/1ppn1Pp1/3pp1p1/NP2P3/P1PPBK2/1RQN2R1 w - - 0 22",
-        "fen r1bqk2r/pppp1ppp/5n2/4b3/4P3/P1N5/1PP2PPP/R1BQKB1R w KQkq - 0 5",
-        "fen r1bqr1k1/pp1p1ppp/2p5/8/3N1Q2/P2BB3/1PP2PPP/R3K2n b Q - 1 12",
-        "fen r1bq2k1/p4r1p/1pp2pp1/3p4/1P1B3Q/P2B1N2/2P3PP/4R1K1 b - - 2 19",
-        "fen r4qk1/6r1/1p4p1/2ppBbN1/1p5Q/P7/2P3PP/5RK1 w - - 2 25",
-        "fen r7/6k1/1p6/2pp1p2/7Q/8/p1P2K1P/8 w - - 0 32",
-        "fen r3k2r/ppp1pp1p/2nqb1pn/3p4/4P3/2PP4/PP1NBPPP/R2QK1NR w KQkq - 1 5",
-        "fen 3r1rk1/1pp1pn1p/p1n1q1p1/3p4/Q3P3/2P5/PP1NBPPP/4RRK1 w - - 0 12",
-        "fen 5rk1/1pp1pn1p/p3Brp1/8/1n6/5N2/PP3PPP/2R2RK1 w - - 2 20",
-        "fen 8/1p2pk1p/p1p1r1p1/3n4/8/5R2/PP3PPP/4R1K1 b - - 3 27",
-        "fen 8/4pk2/1p1r2p1/p1p4p/Pn5P/3R4/1P3PP1/4RK2 w - - 1 33",
-        "fen 8/5k2/1pnrp1p1/p1p4p/P6P/4R1PK/1P3P2/4R3 b - - 1 38",
-        "fen 8/8/1p1kp1p1/p1pr1n1p/P6P/1R4P1/1P3PK1/1R6 b - - 15 45",
-        "fen 8/8/1p1k2p1/p1prp2p/P2n3P/6P1/1P1R1PK1/4R3 b - - 5 49",
-        "fen 8/8/1p4p1/p1p2k1p/P2npP1P/4K1P1/1P6/3R4 w - - 6 54",
-        "fen 8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/6R1 b - - 6 59",
-        "fen 8/5k2/1p4p1/p1pK3p/P2n1P1P/6P1/1P6/4R3 b - - 14 63",
-        "fen 8/1R6/1p1K1kp1/p6p/P1p2P1P/6P1/1Pn5/8 w - - 0 67",
-        "fen 1rb1rn1k/p3q1bp/2p3p1/2p1p3/2P1P2N/PP1RQNP1/1B3P2/4R1K1 b - - 4 23",
-        "fen 4rrk1/pp1n1pp1/q5p1/P1pP4/2n3P1/7P/1P3PB1/R1BQ1RK1 w - - 3 22",
-        "fen r2qr1k1/pb1nbppp/1pn1p3/2ppP3/3P4/2PB1NN1/PP3PPP/R1BQR1K1 w - - 4 12",
-        "fen 2r2k2/8/4P1R1/1p6/8/P4K1N/7b/2B5 b - - 0 55",
-        "fen 6k1/5pp1/8/2bKP2P/2P5/p4PNb/B7/8 b - - 1 44",
-        "fen 2rqr1k1/1p3p1p/p2p2p1/P1nPb3/2B1P3/5P2/1PQ2NPP/R1R4K w - - 3 25",
-        "fen r1b2rk1/p1q1ppbp/6p1/2Q5/8/4BP2/PPP3PP/2KR1B1R b - - 2 14",
-        "fen 6r1/5k2/p1b1r2p/1pB1p1p1/1Pp3PP/2P1R1K1/2P2P2/3R4 w - - 1 36",
-        "fen rnbqkb1r/pppppppp/5n2/8/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
-        "fen 2rr2k1/1p4bp/p1q1p1p1/4Pp1n/2PB4/1PN3P1/P3Q2P/2RR2K1 w - f6 0 20",
-        "fen 3br1k1/p1pn3p/1p3n2/5pNq/2P1p3/1PN3PP/P2Q1PB1/4R1K1 w - - 0 23",
-        "fen 2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93", NULL};
-
-    clock_t benchTime = chess_clock();
-    uint64_t totalNodes = 0;
+    clock_t time;
+    uint64_t nodes;
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t evalProbes;
+    uint64_t evalHits;
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+    int seldepth;
+} bench_result_t;
+
+// Struct for bench settings
+typedef struct bench_params_s
+{
+    int depth;
+    size_t nodes;
+    clock_t movetime;
+    long threads;
+    long hash;
+    char *file;
+    bool json;
+    bool smp;
+    bool movegen;
+} bench_params_t;
+
+// Number of times the moves of each position are generated in the move generation bench
+enum
+{
+    MovegenIterations = 500
+};
+
+// Loads the positions from an EPD or FEN file, one position per line. EPD operations and missing
+// move counters are handled, and empty or '#' lines are skipped. Returns a NULL-terminated list of
+// "fen ..." strings, or NULL if the file can't be read.
+static char **load_positions(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    char **positions = NULL;
+    size_t count = 0;
+    size_t maxCount = 0;
+    char line[4096];
+
+    if (f == NULL) return (NULL);
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char *fields[6];
+        char *cur = line;
+        int fieldCount = 0;
+
+        while (fieldCount < 6 && (fields[fieldCount] = get_next_token(&cur)) != NULL)
+            ++fieldCount;
+
+        if (fieldCount < 4 || fields[0][0] == '#') continue;
+
+        // EPD lines have operations instead of move counters.
+
+        bool hasCounters = fieldCount == 6 && isdigit(fields[4][0]) && isdigit(fields[5][0]);
+
+        if (count + 1 >= maxCount)
+        {
+            maxCount = maxCount ? maxCount * 2 : 64;
+            positions = realloc(positions, sizeof(char *) * maxCount);
+
+            if (positions == NULL)
+            {
+                perror("Unable to allocate bench positions");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        positions[count] = malloc(4200);
+
+        if (positions[count] == NULL)
+        {
+            perror("Unable to allocate bench positions");
+            exit(EXIT_FAILURE);
+        }
+
+        sprintf(positions[count++], "fen %s %s %s %s %s %s", fields[0], fields[1], fields[2],
+            fields[3], hasCounters ? fields[4] : "0", hasCounters ? fields[5] : "1");
+    }
+
+    fclose(f);
+
+    if (positions == NULL) positions = calloc(1, sizeof(char *));
+    if (positions == NULL)
+    {
+        perror("Unable to allocate bench positions");
+        exit(EXIT_FAILURE);
+    }
+
+    positions[count] = NULL;
+    return (positions);
+}
+
+// Searches all given positions with the current settings. If results isn't NULL, the results
+// for each position are stored in it.
+static void bench_run(const bench_params_t *params, const char *const *positions,
+    bench_result_t *results, bench_result_t *total)
+{
+    char buf[128];
+
+    buf[0] = '\0';
+
+    if (params->depth) sprintf(buf + strlen(buf), " depth %d", params->depth);
+    if (params->nodes) sprintf(buf + strlen(buf), " nodes %" FMT_INFO, (info_t)params->nodes);
+    if (params->movetime)
+        sprintf(buf + strlen(buf), " movetime %" FMT_INFO, (info_t)params->movetime);
+
+    memset(total, 0, sizeof(bench_result_t));
 
     for (size_t i = 0; positions[i]; ++i)
     {
-        char buf[4096];
+        bench_result_t cur;
 
-        strcpy(buf, "depth ");
-        strcat(buf, args);
+        cur.time = chess_clock();
         uci_ucinewgame(NULL);
         uci_position(positions[i]);
         uci_go(buf);
         worker_wait_search_end(wpool_main_worker(&WPool));
+        cur.time = chess_clock() - cur.time;
 
         // Retrieve the node counter.
 
-        totalNodes += wpool_get_total_nodes(&WPool);
+        cur.nodes = wpool_get_total_nodes(&WPool);
+        cur.ttProbes = wpool_get_total_tt_probes(&WPool);
+        cur.ttHits = wpool_get_total_tt_hits(&WPool);
+        cur.evalProbes = wpool_get_total_eval_probes(&WPool);
+        cur.evalHits = wpool_get_total_eval_hits(&WPool);
+        cur.pawnProbes = wpool_get_total_pawn_probes(&WPool);
+        cur.pawnHits = wpool_get_total_pawn_hits(&WPool);
+        cur.seldepth = wpool_main_worker(&WPool)->seldepth;
+
+        total->time += cur.time;
+        total->nodes += cur.nodes;
+        total->ttProbes += cur.ttProbes;
+        total->ttHits += cur.ttHits;
+        total->evalProbes += cur.evalProbes;
+        total->evalHits += cur.evalHits;
+        total->pawnProbes += cur.pawnProbes;
+        total->pawnHits += cur.pawnHits;
+        total->seldepth = max(total->seldepth, cur.seldepth);
+
+        if (results) results[i] = cur;
+    }
+}
+
+// Sets the number of threads used for the bench.
+static void bench_set_threads(long threads)
+{
+    if (threads == Options.threads) return;
+
+    Options.threads = threads;
+    wpool_init(&WPool, (size_t)threads);
+}
+
+// Prints the given string as a JSON string.
+static void print_json_string(const char *str)
+{
+    putchar('"');
+
+    for (; *str; ++str)
+    {
+        if (*str == '"' || *str == '\\') putchar('\\');
+        putchar(*str);
+    }
+
+    putchar('"');
+}
+
+// Prints the given result as JSON fields.
+static void print_json_result(const bench_result_t *result)
+{
+    printf("\"nodes\": %" FMT_INFO ", \"time\": %" FMT_INFO ", \"nps\": %" FMT_INFO
+           ", \"tthitrate\": %.4f, \"evalhitrate\": %.4f, \"pawnhitrate\": %.4f"
+           ", \"seldepth\": %d",
+        (info_t)result->nodes, (info_t)result->time,
+        (info_t)(result->nodes * 1000 / (result->time + !result->time)),
+        result->ttHits / (double)(result->ttProbes + !result->ttProbes),
+        result->evalHits / (double)(result->evalProbes + !result->evalProbes),
+        result->pawnHits / (double)(result->pawnProbes + !result->pawnProbes), result->seldepth);
+}
+
+// Prints the bench results as a single line JSON document.
+static void print_json_report(const bench_params_t *params, const char *const *positions,
+    const bench_result_t *results, const bench_result_t *total)
+{
+    printf("{\"settings\": {\"depth\": %d, \"nodes\": %" FMT_INFO ", \"movetime\": %" FMT_INFO
+           ", \"threads\": %ld, \"hash\": %ld}, \"positions\": [",
+        params->depth, (info_t)params->nodes, (info_t)params->movetime, Options.threads,
+        (long)(TT.clusterCount * sizeof(cluster_t) / (1024 * 1024)));
+
+    for (size_t i = 0; positions[i]; ++i)
+    {
+        printf(i ? ", {\"fen\": " : "{\"fen\": ");
+        print_json_string(positions[i] + 4);
+        printf(", ");
+        print_json_result(&results[i]);
+        printf("}");
+    }
+
+    printf("], \"total\": {");
+    print_json_result(total);
+    printf("}}\n");
+}
+
+// Runs the bench for an increasing number of threads, and reports the time to depth and the
+// speedup compared to a single thread.
+static void bench_smp(const bench_params_t *params, const char *const *positions)
+{
+    bench_result_t results[32];
+    long threadCounts[32];
+    int runs = 0;
+
+    // Use powers of two up to the given thread count, and the thread count itself.
+
+    for (long t = 1; t <= params->threads && runs < 32; ++runs)
+    {
+        bench_set_threads(t);
+        bench_run(params, positions, NULL, &results[runs]);
+        threadCounts[runs] = t;
+        t = (t == params->threads) ? t + 1 : min(t * 2, params->threads);
+    }
+
+    printf("SMP benchmark report (%s helper schedule):\n",
+        HelperScheduleNames[Options.helperSchedule]);
+    printf("THREADS       TIME        NODES         NPS  NPS/THREAD  TTD SPEEDUP  NPS SPEEDUP\n");
+
+    const clock_t baseTime = results[0].time + !results[0].time;
+    const uint64_t baseNps = results[0].nodes * 1000 / baseTime;
+
+    // Time to depth speedup is the ratio of the single-threaded bench time
+    // to the bench time with N threads.
+
+    for (int i = 0; i < runs; ++i)
+    {
+        const bench_result_t *r = &results[i];
+        clock_t time = r->time + !r->time;
+        uint64_t nps = r->nodes * 1000 / time;
+
+        printf("%7ld %10" FMT_INFO " %12" FMT_INFO " %11" FMT_INFO " %11" FMT_INFO
+               " %12.2f %12.2f\n",
+            threadCounts[i], (info_t)r->time, (info_t)r->nodes, (info_t)nps,
+            (info_t)(nps / threadCounts[i]), (double)baseTime / time,
+            (double)nps / (baseNps + !baseNps));
+    }
+}
+
+// Generates the legal moves of the given board by filtering the pseudo-legal ones with
+// move_is_legal(), and returns their count.
+static uint64_t movegen_pseudo(const board_t *board)
+{
+    extmove_t moves[256];
+    extmove_t *end;
+    uint64_t count = 0;
+
+    if (board->stack->checkers)
+        end = generate_evasions(moves, board);
+    else
+        end = generate_quiet(generate_captures(moves, board, false), board);
+
+    for (extmove_t *extmove = moves; extmove < end; ++extmove)
+        count += move_is_legal(board, extmove->move);
+
+    return (count);
+}
+
+// Generates the legal moves of the given board with the legal generators, and returns their
+// count.
+static uint64_t movegen_legal(const board_t *board)
+{
+    extmove_t moves[256];
+    extmove_t *end;
+
+    if (board->stack->checkers)
+        end = generate_legal_evasions(moves, board);
+    else
+        end = generate_legal_quiet(generate_legal_captures(moves, board, false), board);
+
+    return ((uint64_t)(end - moves));
+}
+
+// Generates the moves of the given board and of all its children with the given generation
+// function, and returns the total number of legal moves found.
+static uint64_t movegen_position(board_t *board, uint64_t (*generate)(const board_t *))
+{
+    movelist_t list;
+    uint64_t moves = 0;
+
+    list_all(&list, board);
+
+    for (int i = 0; i < MovegenIterations; ++i) moves += generate(board);
+
+    for (const extmove_t *extmove = movelist_begin(&list); extmove < movelist_end(&list);
+         ++extmove)
+    {
+        do_move(board, extmove->move);
+        for (int i = 0; i < MovegenIterations; ++i) moves += generate(board);
+        undo_move(board, extmove->move);
     }
 
-    benchTime = chess_clock() - benchTime;
+    return (moves);
+}
+
+// Compares the speed of the pseudo-legal generation followed by per-move legality checks with
+// the speed of the legal generation on all given positions and their children.
+static void bench_movegen(const char *const *positions)
+{
+    static const char *const Names[2] = {"PSEUDO", "LEGAL "};
+    uint64_t (*const generators[2])(const board_t *) = {movegen_pseudo, movegen_legal};
+
+    printf("Move generation report:\n");
+
+    for (int i = 0; i < 2; ++i)
+    {
+        uint64_t moves = 0;
+        clock_t time = chess_clock();
+
+        for (size_t k = 0; positions[k]; ++k)
+        {
+            uci_position(positions[k]);
+            moves += movegen_position(&Board, generators[i]);
+        }
+
+        time = chess_clock() - time;
+
+        printf("%s %" FMT_INFO " moves, %" FMT_INFO " milliseconds, %" FMT_INFO " moves/s\n",
+            Names[i], (info_t)moves, (info_t)time,
+            (info_t)(moves * 1000 / (time + !time)));
+    }
+}
+
+// Returns the number of online cores, or 8 if it can't be queried.
+static long online_cores(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cores > 0) return (cores);
+#endif
+
+    return (8);
+}
+
+// Parses the bench arguments. The following forms are accepted:
+// - bench [depth] [hash]
+// - bench smp [depth] [maxThreads]
+// - bench movegen [file PATH]
+// - bench [smp] [depth N] [nodes N] [movetime N] [threads N] [hash N] [file PATH] [json]
+static void parse_bench_args(const char *args, bench_params_t *params)
+{
+    char *copy = strdup(args ? args : "");
+    char *cur = copy;
+    char *token;
+    int positional = 0;
+
+    while ((token = get_next_token(&cur)) != NULL)
+    {
+        if (!strcmp(token, "smp"))
+            params->smp = true;
+        else if (!strcmp(token, "json"))
+            params->json = true;
+        else if (!strcmp(token, "movegen"))
+            params->movegen = true;
+        else if (isdigit(token[0]))
+        {
+            // Bare numbers are the depth, then the Hash size (or the max
+            // thread count for SMP benches).
+
+            if (positional == 0)
+                params->depth = atoi(token);
+            else if (positional == 1 && params->smp)
+                params->threads = atol(token);
+            else if (positional == 1)
+                params->hash = atol(token);
+
+            ++positional;
+        }
+        else
+        {
+            char *value = get_next_token(&cur);
+
+            if (value == NULL) break;
+
+            if (!strcmp(token, "depth"))
+                params->depth = atoi(value);
+            else if (!strcmp(token, "nodes"))
+                params->nodes = (size_t)atoll(value);
+            else if (!strcmp(token, "movetime"))
+                params->movetime = (clock_t)atoll(value);
+            else if (!strcmp(token, "threads"))
+                params->threads = atol(value);
+            else if (!strcmp(token, "hash"))
+                params->hash = atol(value);
+            else if (!strcmp(token, "file"))
+                params->file = strdup(value);
+        }
+    }
+
+    free(copy);
+}
+
+void uci_bench(const char *args)
+{
+    // By default, search the bench positions at depth 13 with the current
+    // Threads and Hash settings (up to the number of online cores for the SMP
+    // bench).
+
+    bench_params_t params = {0};
+
+    parse_bench_args(args, &params);
+
+    if (!params.depth && !params.nodes && !params.movetime) params.depth = 13;
+
+    if (!params.threads) params.threads = params.smp ? online_cores() : Options.threads;
+
+    params.threads = clamp(params.threads, 1, 256);
+    params.hash = params.hash ? clamp(params.hash, 1, MAX_HASH) : 0;
+
+    char **filePositions = NULL;
+    const char *const *positions = BenchPositions;
+
+    if (params.file)
+    {
+        filePositions = load_positions(params.file);
+
+        if (filePositions == NULL)
+        {
+            printf("info string Unable to open %s\n", params.file);
+            fflush(stdout);
+            free(params.file);
+            return;
+        }
+
+        positions = (const char *const *)filePositions;
+    }
+
+    const long threads = Options.threads;
+
+    if (params.hash) tt_resize((size_t)params.hash);
+
+#ifdef STATS
+    stats_reset();
+#endif
+
+    if (params.movegen)
+        bench_movegen(positions);
+    else if (params.smp)
+        bench_smp(&params, positions);
+    else
+    {
+        size_t count = 0;
+
+        while (positions[count]) ++count;
+
+        bench_result_t *results = malloc(sizeof(bench_result_t) * (count + 1));
+        bench_result_t total;
+
+        if (results == NULL)
+        {
+            perror("Unable to allocate bench results");
+            exit(EXIT_FAILURE);
+        }
+
+        // With a network loaded, the main report is done with the classical
+        // evaluation, so that the node count stays comparable. The network is
+        // then benched separately.
+
+        const bool nnue = NnueLoaded && !params.json;
+
+        if (nnue) nnue_unload();
+
+        bench_set_threads(params.threads);
+        bench_run(&params, positions, results, &total);
+
+        if (params.json)
+            print_json_report(&params, positions, results, &total);
+        else
+        {
+            clock_t benchTime = total.time + !total.time;
+
+            printf("Benchmark report:\n");
+            printf("TIME:  %" FMT_INFO " milliseconds\n", (info_t)total.time);
+            printf("NODES: %" FMT_INFO "\n", (info_t)total.nodes);
+            printf("NPS:   %" FMT_INFO "\n", (info_t)((total.nodes * 1000) / benchTime));
+            printf("TT:    %" FMT_INFO " entries, %.2f%% hit rate\n",
+                (info_t)(TT.clusterCount * ClusterSize),
+                total.ttHits * 100.0 / (total.ttProbes + !total.ttProbes));
+            printf("EVAL:  %" FMT_INFO " entries, %.2f%% hit rate\n",
+                (info_t)wpool_main_worker(&WPool)->evalCacheSize,
+                total.evalHits * 100.0 / (total.evalProbes + !total.evalProbes));
+            printf("PAWNS: %" FMT_INFO " entries, %.2f%% hit rate\n",
+                (info_t)wpool_main_worker(&WPool)->pawnTableSize,
+                total.pawnHits * 100.0 / (total.pawnProbes + !total.pawnProbes));
+
+            // Report how much the searches went past the requested movetime.
+
+            if (params.movetime)
+            {
+                long maxOvershoot = LONG_MIN;
+                long sumOvershoot = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    long overshoot = (long)(results[i].time - params.movetime);
+
+                    sumOvershoot += overshoot;
+                    maxOvershoot = max(maxOvershoot, overshoot);
+                }
+
+                printf("OVERSHOOT: %.2f milliseconds on average, %ld at most\n",
+                    (double)sumOvershoot / (double)count, maxOvershoot);
+            }
+        }
+
+        if (nnue)
+        {
+            NnueLoaded = true;
+            bench_run(&params, positions, NULL, &total);
+
+            clock_t nnueTime = total.time + !total.time;
+
+            printf("NNUE:  %" FMT_INFO " milliseconds, %" FMT_INFO " nodes, %" FMT_INFO " nps\n",
+                (info_t)total.time, (info_t)total.nodes,
+                (info_t)((total.nodes * 1000) / nnueTime));
+        }
+
+        free(results);
+    }
+
+#ifdef STATS
+    stats_print();
+#endif
 
-    printf("Benchmark report:\n");
-    printf("TIME:  %" FMT_INFO " milliseconds\n", (info_t)benchTime);
-    printf("NODES: %" FMT_INFO "\n", (info_t)totalNodes);
-    printf("NPS:   %" FMT_INFO "\n", (info_t)((totalNodes * 1000) / benchTime));
     fflush(stdout);
+
+    // Restore the engine settings.
+
+    bench_set_threads(threads);
+    if (params.hash) tt_resize((size_t)Options.hash);
+
+    if (filePositions)
+    {
+        for (size_t i = 0; filePositions[i]; ++i) free(filePositions[i]);
+        free(filePositions);
+    }
+
+    free(params.file);
 }
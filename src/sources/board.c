@@ -23,6 +23,7 @@
 #include "uci.h"
 #include "worker.h"
 #include <ctype.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -176,6 +177,10 @@ void set_board(board_t *board, char *fen, bool isChess960, boardstack_t *bstack)
     board->ply += (board->sideToMove == BLACK);
     board->chess960 = isChess960;
 
+#ifdef INCREMENTAL_EVAL
+    update_piece_attacks(board, occupancy_bb(board));
+#endif
+
     set_boardstack(board, board->stack);
 }
 
@@ -183,10 +188,12 @@ void set_boardstack(board_t *board, boardstack_t *stack)
 {
     stack->boardKey = stack->pawnKey = board->stack->materialKey = 0;
     stack->material[WHITE] = stack->material[BLACK] = 0;
+    stack->dirtyPieces.count = 0;
+    stack->accumulator.computed = false;
     stack->checkers = attackers_to(board, get_king_square(board, board->sideToMove))
                       & color_bb(board, not_color(board->sideToMove));
 
-    set_check(board, stack);
+    stack->blockersValid = stack->checkSquaresValid = false;
 
     for (bitboard_t b = occupancy_bb(board); b;)
     {
@@ -238,13 +245,17 @@ void set_castling(board_t *board, color_t color, square_t rookSquare)
         & ~(square_bb(kingSquare) | square_bb(rookSquare));
 }
 
-void set_check(board_t *board, boardstack_t *stack)
+void set_blockers(const board_t *board, boardstack_t *stack)
 {
     stack->kingBlockers[WHITE] = slider_blockers(
         board, color_bb(board, BLACK), get_king_square(board, WHITE), &stack->pinners[BLACK]);
     stack->kingBlockers[BLACK] = slider_blockers(
         board, color_bb(board, WHITE), get_king_square(board, BLACK), &stack->pinners[WHITE]);
+    stack->blockersValid = true;
+}
 
+void set_check_squares(const board_t *board, boardstack_t *stack)
+{
     square_t kingSquare = get_king_square(board, not_color(board->sideToMove));
 
     stack->checkSquares[PAWN] = pawn_moves(kingSquare, not_color(board->sideToMove));
@@ -253,27 +264,31 @@ void set_check(board_t *board, boardstack_t *stack)
     stack->checkSquares[ROOK] = rook_moves(board, kingSquare);
     stack->checkSquares[QUEEN] = stack->checkSquares[BISHOP] | stack->checkSquares[ROOK];
     stack->checkSquares[KING] = 0;
+    stack->checkSquaresValid = true;
 }
 
-boardstack_t *dup_boardstack(const boardstack_t *stack)
+size_t boardstack_history(const boardstack_t *stack)
 {
-    if (!stack) return (NULL);
+    // Repetitions are only looked for since the last irreversible move or null move.
 
-    boardstack_t *newStack = malloc(sizeof(boardstack_t));
+    size_t plies = (size_t)min(stack->rule50, stack->pliesFromNullMove);
+    size_t count = 1;
 
-    *newStack = *stack;
-    newStack->prev = dup_boardstack(stack->prev);
-    return (newStack);
+    while (count <= plies && (stack = stack->prev) != NULL) ++count;
+
+    return (count);
 }
 
-void free_boardstack(boardstack_t *stack)
+boardstack_t *copy_boardstack(boardstack_t *frames, const boardstack_t *stack, size_t count)
 {
-    while (stack)
+    for (size_t i = count; i > 0; --i)
     {
-        boardstack_t *next = stack->prev;
-        free(stack);
-        stack = next;
+        frames[i - 1] = *stack;
+        frames[i - 1].prev = (i > 1) ? &frames[i - 2] : NULL;
+        stack = stack->prev;
     }
+
+    return (&frames[count - 1]);
 }
 
 const char *board_fen(const board_t *board)
@@ -334,10 +349,60 @@ const char *board_fen(const board_t *board)
     return fenBuffer;
 }
 
-void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck)
+#ifdef INCREMENTAL_EVAL
+void update_piece_attacks(board_t *board, bitboard_t changed)
+{
+    const bitboard_t occupied = occupancy_bb(board);
+    const bitboard_t bishops = piecetypes_bb(board, BISHOP, QUEEN);
+    const bitboard_t rooks = piecetypes_bb(board, ROOK, QUEEN);
+    bitboard_t refresh = changed & occupied & ~piecetypes_bb(board, PAWN, KING);
+
+    // A slider's attacks only change if one of the changed squares is on its
+    // lines. The first changed square met along a line is reachable both before
+    // and after the move, so checking with the new occupancy is enough.
+
+    for (bitboard_t b = changed; b;)
+    {
+        square_t sq = bb_pop_first_sq(&b);
+
+        refresh |= bishop_moves_bb(sq, occupied) & bishops;
+        refresh |= rook_moves_bb(sq, occupied) & rooks;
+    }
+
+    while (refresh)
+    {
+        square_t sq = bb_pop_first_sq(&refresh);
+
+        board->pieceAttacks[sq] = piece_moves(piece_type(piece_on(board, sq)), sq, occupied);
+    }
+}
+
+// Returns the squares whose content is changed by the given move.
+static bitboard_t move_changed_squares(move_t move, color_t us)
 {
-    get_worker(board)->nodes += 1;
+    square_t from = from_sq(move), to = to_sq(move);
+    bitboard_t changed = square_bb(from) | square_bb(to);
+
+    if (move_type(move) == EN_PASSANT)
+        changed |= square_bb(to - pawn_direction(us));
 
+    else if (move_type(move) == CASTLING)
+    {
+        bool kingside = to > from;
+
+        changed |= square_bb(relative_sq(kingside ? SQ_G1 : SQ_C1, us));
+        changed |= square_bb(relative_sq(kingside ? SQ_F1 : SQ_D1, us));
+    }
+
+    return (changed);
+}
+#endif
+
+void do_move_gc(board_t *board, move_t move, bool givesCheck)
+{
+    worker_add_node(get_worker(board));
+
+    boardstack_t *next = board->stack + 1;
     hashkey_t key = board->stack->boardKey ^ ZobristBlackToMove;
 
     next->castlings = board->stack->castlings;
@@ -350,6 +415,8 @@ void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck
     next->material[BLACK] = board->stack->material[BLACK];
 
     next->prev = board->stack;
+    next->dirtyPieces.count = 0;
+    next->accumulator.computed = false;
     board->stack = next;
     board->ply += 1;
     board->stack->rule50 += 1;
@@ -366,6 +433,8 @@ void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck
         square_t rookFrom, rookTo;
 
         do_castling(board, us, from, &to, &rookFrom, &rookTo);
+        add_dirty_piece(board->stack, piece, from, to);
+        add_dirty_piece(board->stack, capturedPiece, rookFrom, rookTo);
 
         key ^= ZobristPsq[capturedPiece][rookFrom];
         key ^= ZobristPsq[capturedPiece][rookTo];
@@ -387,6 +456,7 @@ void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck
             board->stack->material[them] -= PieceScores[MIDGAME][capturedPiece];
 
         remove_piece(board, capturedSquare);
+        add_dirty_piece(board->stack, capturedPiece, capturedSquare, SQ_NONE);
 
         if (move_type(move) == EN_PASSANT) board->table[capturedSquare] = NO_PIECE;
 
@@ -411,7 +481,11 @@ void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck
         board->stack->castlings &= ~castling;
     }
 
-    if (move_type(move) != CASTLING) move_piece(board, from, to);
+    if (move_type(move) != CASTLING)
+    {
+        move_piece(board, from, to);
+        add_dirty_piece(board->stack, piece, from, to);
+    }
 
     if (piece_type(piece) == PAWN)
     {
@@ -427,6 +501,8 @@ void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck
 
             remove_piece(board, to);
             put_piece(board, newPiece, to);
+            add_dirty_piece(board->stack, piece, to, SQ_NONE);
+            add_dirty_piece(board->stack, newPiece, SQ_NONE, to);
 
             key ^= ZobristPsq[piece][to] ^ ZobristPsq[newPiece][to];
             board->stack->pawnKey ^= ZobristPsq[piece][to];
@@ -443,30 +519,33 @@ void do_move_gc(board_t *board, move_t move, boardstack_t *next, bool givesCheck
     board->stack->capturedPiece = capturedPiece;
     board->stack->boardKey = key;
 
+#ifdef INCREMENTAL_EVAL
+    update_piece_attacks(board, move_changed_squares(move, us));
+#endif
+
     prefetch(tt_entry_at(key));
 
     board->stack->checkers =
         givesCheck ? attackers_to(board, get_king_square(board, them)) & color_bb(board, us) : 0;
 
     board->sideToMove = not_color(board->sideToMove);
-
-    set_check(board, board->stack);
+    board->stack->blockersValid = board->stack->checkSquaresValid = false;
 
     board->stack->repetition = 0;
 
     int repetitionPlies = min(board->stack->rule50, board->stack->pliesFromNullMove);
 
-    if (repetitionPlies >= 4)
+    // The stack frames are contiguous, so the previous positions can be scanned
+    // by index.
+
+    for (int i = 4; i <= repetitionPlies; i += 2)
     {
-        boardstack_t *rewind = board->stack->prev->prev;
-        for (int i = 4; i <= repetitionPlies; i += 2)
+        const boardstack_t *rewind = board->stack - i;
+
+        if (rewind->boardKey == board->stack->boardKey)
         {
-            rewind = rewind->prev->prev;
-            if (rewind->boardKey == board->stack->boardKey)
-            {
-                board->stack->repetition = rewind->repetition ? -i : i;
-                break;
-            }
+            board->stack->repetition = rewind->repetition ? -i : i;
+            break;
         }
     }
 }
@@ -503,6 +582,10 @@ void undo_move(board_t *board, move_t move)
         }
     }
 
+#ifdef INCREMENTAL_EVAL
+    update_piece_attacks(board, move_changed_squares(move, us));
+#endif
+
     board->stack = board->stack->prev;
     board->ply -= 1;
 }
@@ -539,12 +622,19 @@ void undo_castling(board_t *board, color_t us, square_t kingFrom, square_t *king
     put_piece(board, create_piece(us, ROOK), *rookFrom);
 }
 
-void do_null_move(board_t *board, boardstack_t *stack)
+void do_null_move(board_t *board)
 {
-    get_worker(board)->nodes += 1;
+    boardstack_t *stack = board->stack + 1;
+
+    worker_add_node(get_worker(board));
+
+    // Don't copy the accumulator, it is lazily rebuilt from the previous one if
+    // needed.
 
-    memcpy(stack, board->stack, sizeof(boardstack_t));
+    memcpy(stack, board->stack, offsetof(boardstack_t, accumulator));
     stack->prev = board->stack;
+    stack->dirtyPieces.count = 0;
+    stack->accumulator.computed = false;
     board->stack = stack;
 
     if (stack->enPassantSquare != SQ_NONE)
@@ -561,7 +651,9 @@ void do_null_move(board_t *board, boardstack_t *stack)
 
     board->sideToMove = not_color(board->sideToMove);
 
-    set_check(board, stack);
+    // The pieces didn't move, so only the check squares need to be recomputed.
+
+    stack->checkSquaresValid = false;
 
     stack->repetition = 0;
 }
@@ -632,12 +724,11 @@ bool game_has_cycle(const board_t *board, int ply)
     if (maxPlies < 3) return (false);
 
     hashkey_t originalKey = board->stack->boardKey;
-    boardstack_t *stackIt = board->stack->prev;
 
     for (int i = 3; i <= maxPlies; i += 2)
     {
         // Only check for cycles from a single side.
-        stackIt = stackIt->prev->prev;
+        const boardstack_t *stackIt = board->stack - i;
 
         hashkey_t moveKey = originalKey ^ stackIt->boardKey;
 
@@ -683,12 +774,12 @@ bool move_gives_check(const board_t *board, move_t move)
     bitboard_t occupied;
     color_t us = board->sideToMove, them = not_color(board->sideToMove);
 
-    if (board->stack->checkSquares[piece_type(piece_on(board, from))] & square_bb(to))
+    if (check_squares(board, piece_type(piece_on(board, from))) & square_bb(to))
         return (true);
 
     square_t theirKing = get_king_square(board, them);
 
-    if ((board->stack->kingBlockers[them] & square_bb(from)) && !sq_aligned(from, to, theirKing))
+    if ((king_blockers(board, them) & square_bb(from)) && !sq_aligned(from, to, theirKing))
         return (true);
 
     switch (move_type(move))
@@ -767,7 +858,7 @@ bool move_is_legal(const board_t *board, move_t move)
     // If the moving piece is pinned, checks if the move generates
     // a discovered check.
 
-    return (!(board->stack->kingBlockers[us] & square_bb(from))
+    return (!(king_blockers(board, us) & square_bb(from))
             || sq_aligned(from, to, get_king_square(board, us)));
 }
 
@@ -877,9 +968,9 @@ bool see_greater_than(const board_t *board, move_t m, score_t threshold)
 
         if (!(stmAttackers = attackers & color_bb(board, sideToMove))) break;
 
-        if (board->stack->pinners[not_color(sideToMove)] & occupied)
+        if (pinners_bb(board, not_color(sideToMove)) & occupied)
         {
-            stmAttackers &= ~board->stack->kingBlockers[sideToMove];
+            stmAttackers &= ~king_blockers(board, sideToMove);
             if (!stmAttackers) break;
         }
 
@@ -925,3 +1016,68 @@ bool see_greater_than(const board_t *board, move_t m, score_t threshold)
     }
     return (result);
 }
+
+score_t see_value(const board_t *board, move_t m)
+{
+    if (move_type(m) != NORMAL_MOVE) return (0);
+
+    square_t from = from_sq(m), to = to_sq(m);
+    bitboard_t occupied = occupancy_bb(board) ^ square_bb(from) ^ square_bb(to);
+    color_t sideToMove = piece_color(piece_on(board, from));
+    bitboard_t attackers = attackers_list(board, to, occupied);
+    bitboard_t stmAttackers, b;
+    score_t gain[32];
+    score_t onSquare = PieceScores[MIDGAME][piece_on(board, from)];
+    int d = 0;
+
+    gain[0] = PieceScores[MIDGAME][piece_on(board, to)];
+
+    // Play all captures on the destination square with the least valuable
+    // attacker, following the same rules as see_greater_than().
+
+    while (true)
+    {
+        piecetype_t pt;
+
+        sideToMove = not_color(sideToMove);
+        attackers &= occupied;
+
+        if (!(stmAttackers = attackers & color_bb(board, sideToMove))) break;
+
+        if (pinners_bb(board, not_color(sideToMove)) & occupied)
+        {
+            stmAttackers &= ~king_blockers(board, sideToMove);
+            if (!stmAttackers) break;
+        }
+
+        for (pt = PAWN; pt < KING; ++pt)
+            if ((b = stmAttackers & piecetype_bb(board, pt))) break;
+
+        // The King can only capture if the square isn't defended anymore.
+
+        if (pt == KING && (attackers & ~color_bb(board, sideToMove))) break;
+
+        ++d;
+        gain[d] = onSquare - gain[d - 1];
+        onSquare = PieceScores[MIDGAME][create_piece(sideToMove, pt)];
+
+        if (pt == KING) break;
+
+        occupied ^= square_bb(bb_first_sq(b));
+
+        if (pt == PAWN || pt == BISHOP || pt == QUEEN)
+            attackers |= bishop_moves_bb(to, occupied) & piecetypes_bb(board, BISHOP, QUEEN);
+        if (pt == ROOK || pt == QUEEN)
+            attackers |= rook_moves_bb(to, occupied) & piecetypes_bb(board, ROOK, QUEEN);
+    }
+
+    // Each side can stop capturing when it would lose material by going on.
+
+    while (d > 0)
+    {
+        gain[d - 1] = -max(-gain[d - 1], gain[d]);
+        --d;
+    }
+
+    return (gain[0]);
+}
@@ -21,6 +21,7 @@
 #include "movelist.h"
 #include "pawns.h"
 #include "types.h"
+#include "worker.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -35,30 +36,6 @@ evaltrace_t Trace;
 const scorepair_t CastlingBonus = SPAIR(92, -87);
 const scorepair_t Initiative = SPAIR(12, 5);
 
-// Passed Pawn eval terms
-
-const scorepair_t PP_OurKingProximity[8] = {
-    0,
-    SPAIR(  -8,  37),
-    SPAIR( -18,  27),
-    SPAIR( -14,  -1),
-    SPAIR(  -8, -15),
-    SPAIR(   0, -18),
-    SPAIR(  20, -24),
-    SPAIR(  -1, -24)
-};
-
-const scorepair_t PP_TheirKingProximity[8] = {
-    0,
-    SPAIR( -51,-111),
-    SPAIR(  12, -25),
-    SPAIR(   1,   3),
-    SPAIR(   3,  18),
-    SPAIR(   4,  29),
-    SPAIR(   5,  37),
-    SPAIR(  -4,  32)
-};
-
 // King Safety eval terms
 
 const scorepair_t KnightWeight    = SPAIR(  35,   3);
@@ -153,15 +130,6 @@ typedef struct evaluation_s
     int positionClosed;
 } evaluation_t;
 
-bool is_kxk_endgame(const board_t *board, color_t us)
-{
-    // Weak side has pieces or Pawns, this is not a KXK endgame.
-
-    if (more_than_one(color_bb(board, not_color(us)))) return (false);
-
-    return (board->stack->material[us] >= ROOK_MG_SCORE);
-}
-
 score_t eval_kxk(const board_t *board, color_t us)
 {
     // Be careful to avoid stalemating the weak King.
@@ -224,7 +192,8 @@ bool ocb_endgame(const board_t *board)
     return (!!dsqMask && !more_than_one(dsqMask));
 }
 
-score_t scale_endgame(const board_t *board, const pawn_entry_t *pe, score_t eg)
+score_t scale_endgame(
+    const board_t *board, const pawn_entry_t *pe, const material_entry_t *me, score_t eg)
 {
     // Only detect scalable endgames from the side with a positive evaluation.
     // This allows us to quickly filter out positions which shouldn't be scaled,
@@ -238,17 +207,15 @@ score_t scale_endgame(const board_t *board, const pawn_entry_t *pe, score_t eg)
                weakPawns = piece_bb(board, weakSide, PAWN);
 
     // No Pawns and low material difference, the endgame is either drawn
-    // or very difficult to win.
+    // or very difficult to win. The factor only depends on material, so
+    // it comes from the material entry.
 
-    if (!strongPawns && strongMat - weakMat <= BISHOP_MG_SCORE)
-        factor = (strongMat <= BISHOP_MG_SCORE)
-                     ? 0
-                     : max((int32_t)(strongMat - weakMat) * 8 / BISHOP_MG_SCORE, 0);
+    if (me->scaleFactor[strongSide] != ScaleUnknown) factor = me->scaleFactor[strongSide];
 
     // OCB endgames: scale based on the number of remaining pieces of the strong side,
     // or if there are no other remaining pieces, based on the number of passed pawns.
 
-    else if (ocb_endgame(board))
+    else if (me->ocbCandidate && ocb_endgame(board))
         factor = (strongMat + weakMat > 2 * BISHOP_MG_SCORE)
                      ? 36 + popcount(color_bb(board, strongSide)) * 6
                      : 16 + popcount(pe->passed[strongSide]) * 8;
@@ -257,8 +224,7 @@ score_t scale_endgame(const board_t *board, const pawn_entry_t *pe, score_t eg)
     // are on the same side of the board. Don't scale if the defending King is far from
     // his own Pawns.
 
-    else if (strongMat == ROOK_MG_SCORE && weakMat == ROOK_MG_SCORE
-             && (popcount(strongPawns) - popcount(weakPawns) < 2)
+    else if (me->rookEndgame[strongSide]
              && !!(KINGSIDE_BITS & strongPawns) != !!(QUEENSIDE_BITS & strongPawns)
              && (king_moves(get_king_square(board, weakSide)) & weakPawns))
         factor = 64;
@@ -267,7 +233,7 @@ score_t scale_endgame(const board_t *board, const pawn_entry_t *pe, score_t eg)
     // side gets lower.
 
     else
-        factor = min(128, 96 + 8 * popcount(strongPawns));
+        factor = me->defaultFactor[strongSide];
 
     // Be careful to cast to 32-bit integer here before multiplying to avoid overflows.
 
@@ -363,7 +329,7 @@ scorepair_t evaluate_knights(
 
         // If the Knight is pinned, it has no Mobility squares.
 
-        if (board->stack->kingBlockers[us] & sqbb) b = 0;
+        if (king_blockers(board, us) & sqbb) b = 0;
 
         // Update attack tables.
 
@@ -422,7 +388,6 @@ scorepair_t evaluate_knights(
 scorepair_t evaluate_bishops(const board_t *board, evaluation_t *eval, color_t us)
 {
     scorepair_t ret = 0;
-    const bitboard_t occupancy = occupancy_bb(board);
     bitboard_t bb = piece_bb(board, us, BISHOP);
     bitboard_t ourPawns = piece_bb(board, us, PAWN);
 
@@ -438,7 +403,7 @@ scorepair_t evaluate_bishops(const board_t *board, evaluation_t *eval, color_t u
     {
         square_t sq = bb_pop_first_sq(&bb);
         bitboard_t sqbb = square_bb(sq);
-        bitboard_t b = bishop_moves_bb(sq, occupancy);
+        bitboard_t b = piece_attacks(board, BISHOP, sq);
 
         TRACE_ADD(IDX_PIECE + BISHOP - PAWN, us, 1);
         TRACE_ADD(IDX_PSQT + 48 + (BISHOP - KNIGHT) * 32 + to_sq32(relative_sq(sq, us)), us, 1);
@@ -446,7 +411,7 @@ scorepair_t evaluate_bishops(const board_t *board, evaluation_t *eval, color_t u
         // If the Bishop is pinned, reduce its mobility to all the squares
         // between the King and the pinner.
 
-        if (board->stack->kingBlockers[us] & sqbb) b &= LineBits[get_king_square(board, us)][sq];
+        if (king_blockers(board, us) & sqbb) b &= LineBits[get_king_square(board, us)][sq];
 
         // Update attack tables.
 
@@ -484,7 +449,6 @@ scorepair_t evaluate_bishops(const board_t *board, evaluation_t *eval, color_t u
 scorepair_t evaluate_rooks(const board_t *board, evaluation_t *eval, color_t us)
 {
     scorepair_t ret = 0;
-    const bitboard_t occupancy = occupancy_bb(board);
     const bitboard_t ourPawns = piece_bb(board, us, PAWN);
     const bitboard_t theirPawns = piece_bb(board, not_color(us), PAWN);
     const bitboard_t theirQueens = piece_bb(board, not_color(us), QUEEN);
@@ -495,7 +459,7 @@ scorepair_t evaluate_rooks(const board_t *board, evaluation_t *eval, color_t us)
         square_t sq = bb_pop_first_sq(&bb);
         bitboard_t sqbb = square_bb(sq);
         bitboard_t rookFile = sq_file_bb(sq);
-        bitboard_t b = rook_moves_bb(sq, occupancy);
+        bitboard_t b = piece_attacks(board, ROOK, sq);
 
         TRACE_ADD(IDX_PIECE + ROOK - PAWN, us, 1);
         TRACE_ADD(IDX_PSQT + 48 + (ROOK - KNIGHT) * 32 + to_sq32(relative_sq(sq, us)), us, 1);
@@ -503,7 +467,7 @@ scorepair_t evaluate_rooks(const board_t *board, evaluation_t *eval, color_t us)
         // If the Rook is pinned, reduce its mobility to all the squares
         // between the King and the pinner.
 
-        if (board->stack->kingBlockers[us] & sqbb) b &= LineBits[get_king_square(board, us)][sq];
+        if (king_blockers(board, us) & sqbb) b &= LineBits[get_king_square(board, us)][sq];
 
         // Update attack tables.
 
@@ -549,14 +513,13 @@ scorepair_t evaluate_rooks(const board_t *board, evaluation_t *eval, color_t us)
 scorepair_t evaluate_queens(const board_t *board, evaluation_t *eval, color_t us)
 {
     scorepair_t ret = 0;
-    const bitboard_t occupancy = occupancy_bb(board);
     bitboard_t bb = piece_bb(board, us, QUEEN);
 
     while (bb)
     {
         square_t sq = bb_pop_first_sq(&bb);
         bitboard_t sqbb = square_bb(sq);
-        bitboard_t b = bishop_moves_bb(sq, occupancy) | rook_moves_bb(sq, occupancy);
+        bitboard_t b = piece_attacks(board, QUEEN, sq);
 
         TRACE_ADD(IDX_PIECE + QUEEN - PAWN, us, 1);
         TRACE_ADD(IDX_PSQT + 48 + (QUEEN - KNIGHT) * 32 + to_sq32(relative_sq(sq, us)), us, 1);
@@ -564,7 +527,7 @@ scorepair_t evaluate_queens(const board_t *board, evaluation_t *eval, color_t us
         // If the Queen is pinned, reduce its mobility to all the squares
         // between the King and the pinner.
 
-        if (board->stack->kingBlockers[us] & sqbb) b &= LineBits[get_king_square(board, us)][sq];
+        if (king_blockers(board, us) & sqbb) b &= LineBits[get_king_square(board, us)][sq];
 
         // Update attack tables.
 
@@ -591,33 +554,6 @@ scorepair_t evaluate_queens(const board_t *board, evaluation_t *eval, color_t us
     return (ret);
 }
 
-scorepair_t evaluate_passed_pos(const board_t *board, const pawn_entry_t *entry, color_t us)
-{
-    scorepair_t ret = 0;
-    square_t ourKing = get_king_square(board, us);
-    square_t theirKing = get_king_square(board, not_color(us));
-    bitboard_t bb = entry->passed[us];
-
-    while (bb)
-    {
-        square_t sq = bb_pop_first_sq(&bb);
-
-        // Give a bonus/penalty based on how close is our King and their King
-        // from the Pawn.
-
-        int ourDistance = SquareDistance[ourKing][sq];
-        int theirDistance = SquareDistance[theirKing][sq];
-
-        ret += PP_OurKingProximity[ourDistance];
-        ret += PP_TheirKingProximity[theirDistance];
-
-        TRACE_ADD(IDX_PP_OUR_KING_PROX + ourDistance - 1, us, 1);
-        TRACE_ADD(IDX_PP_THEIR_KING_PROX + theirDistance - 1, us, 1);
-    }
-
-    return (ret);
-}
-
 scorepair_t evaluate_threats(const board_t *board, const evaluation_t *eval, color_t us)
 {
     color_t them = not_color(us);
@@ -744,15 +680,19 @@ score_t evaluate(const board_t *board)
 {
     TRACE_INIT;
 
+    const material_entry_t *me = material_probe(board);
+
     // Do we have a specialized endgame eval for the current configuration ?
-    const endgame_entry_t *entry = endgame_probe(board);
 
-    if (entry != NULL) return (entry->func(board, entry->winningSide));
+    if (me->endgame != NULL) return (me->endgame->func(board, me->endgame->winningSide));
 
     // Is there a KXK situation ? (lone King vs mating material)
 
-    if (is_kxk_endgame(board, WHITE)) return (eval_kxk(board, WHITE));
-    if (is_kxk_endgame(board, BLACK)) return (eval_kxk(board, BLACK));
+    if (me->kxkSide != COLOR_NB) return (eval_kxk(board, me->kxkSide));
+
+    // Use the network for all other positions if one is loaded.
+
+    if (NnueLoaded) return (nnue_evaluate(board));
 
     evaluation_t eval;
     scorepair_t tapered = board->psqScorePair;
@@ -794,8 +734,7 @@ score_t evaluate(const board_t *board)
 
     // Add the Passed Pawn evaluation.
 
-    tapered += evaluate_passed_pos(board, pe, WHITE);
-    tapered -= evaluate_passed_pos(board, pe, BLACK);
+    tapered += pawn_king_value(board, pe);
 
     // Add the threat evaluation.
 
@@ -820,14 +759,12 @@ score_t evaluate(const board_t *board)
 
     // Scale endgame score based on remaining material + Pawns.
 
-    eg = scale_endgame(board, pe, endgame_score(tapered));
+    eg = scale_endgame(board, pe, me, endgame_score(tapered));
 
     // Compute the eval by interpolating between the middlegame and endgame scores.
 
     {
-        int phase = 4 * popcount(piecetype_bb(board, QUEEN))
-                    + 2 * popcount(piecetype_bb(board, ROOK))
-                    + popcount(piecetypes_bb(board, KNIGHT, BISHOP));
+        int phase = me->phase;
 
         if (phase >= 24)
         {
@@ -846,3 +783,26 @@ score_t evaluate(const board_t *board)
 
     return (board->sideToMove == WHITE ? score : -score);
 }
+
+score_t evaluate_cached(const board_t *board)
+{
+    // The cache is private to each worker, so no synchronization is needed.
+
+    worker_t *worker = get_worker(board);
+    const hashkey_t key = board->stack->boardKey;
+    const eval_entry_t keyMask = ((eval_entry_t)1 << 48) - 1;
+    eval_entry_t *entry = worker->evalCache + mul_hi64(key, worker->evalCacheSize);
+
+    worker->evalProbes++;
+
+    if (!((*entry ^ key) & keyMask))
+    {
+        worker->evalHits++;
+        return ((score_t)(int16_t)(*entry >> 48));
+    }
+
+    score_t eval = evaluate(board);
+
+    *entry = (key & keyMask) | ((eval_entry_t)(uint16_t)eval << 48);
+    return (eval);
+}
@@ -20,6 +20,21 @@
 #include "search.h"
 #include "worker.h"
 
+void age_history(int16_t *table, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) table[i] >>= HistoryAgingShift;
+}
+
+// Updates the continuation histories of the previous plies for the given piece and destination
+// square.
+static void update_continuation_histories(
+    searchstack_t *ss, piece_t piece, square_t to, int32_t bonus)
+{
+    for (int i = 0; i < ContinuationPlies; ++i)
+        if ((ss - continuation_ply(i))->pieceHistory != NULL)
+            add_pc_history(*(ss - continuation_ply(i))->pieceHistory, piece, to, bonus);
+}
+
 void update_quiet_history(const board_t *board, int depth, move_t bestmove, const move_t quiets[64],
     int qcount, searchstack_t *ss)
 {
@@ -42,9 +57,9 @@ void update_quiet_history(const board_t *board, int depth, move_t bestmove, cons
         lastPiece = piece_on(board, lastTo);
 
         get_worker(board)->cmHistory[lastPiece][lastTo] = bestmove;
-        add_pc_history(*(ss - 1)->pieceHistory, piece, to, bonus);
     }
-    if ((ss - 2)->pieceHistory != NULL) add_pc_history(*(ss - 2)->pieceHistory, piece, to, bonus);
+
+    update_continuation_histories(ss, piece, to, bonus);
 
     add_bf_history(*bfHist, piece, bestmove, bonus);
 
@@ -63,11 +78,7 @@ void update_quiet_history(const board_t *board, int depth, move_t bestmove, cons
         piece = piece_on(board, from_sq(quiets[i]));
         to = to_sq(quiets[i]);
         add_bf_history(*bfHist, piece, quiets[i], -bonus);
-
-        if ((ss - 1)->pieceHistory != NULL)
-            add_pc_history(*(ss - 1)->pieceHistory, piece, to, -bonus);
-        if ((ss - 2)->pieceHistory != NULL)
-            add_pc_history(*(ss - 2)->pieceHistory, piece, to, -bonus);
+        update_continuation_histories(ss, piece, to, -bonus);
     }
 }
 
@@ -36,7 +36,7 @@ movelist_t SearchMoves;
 
 uint64_t Seed = 1048592ul;
 
-ucioptions_t Options = {1, 16, 100, 1, false, false};
+ucioptions_t Options = {1, 16, 1, 3, 100, 1, false, false, ScheduleUniform, BindNone};
 
 timeman_t Timeman;
 
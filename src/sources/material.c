@@ -0,0 +1,87 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "material.h"
+#include "worker.h"
+
+static bool is_kxk_endgame(const board_t *board, color_t us)
+{
+    // Weak side has pieces or Pawns, this is not a KXK endgame.
+
+    if (more_than_one(color_bb(board, not_color(us)))) return (false);
+
+    return (board->stack->material[us] >= ROOK_MG_SCORE);
+}
+
+material_entry_t *material_probe(const board_t *board)
+{
+#ifndef TUNE
+    material_entry_t *entry =
+        get_worker(board)->materialTable + (board->stack->materialKey % MaterialTableSize);
+
+    if (entry->key == board->stack->materialKey) return (entry);
+
+#else
+    static material_entry_t e;
+    material_entry_t *entry = &e;
+#endif
+
+    entry->key = board->stack->materialKey;
+    entry->endgame = endgame_probe(board);
+
+    if (is_kxk_endgame(board, WHITE))
+        entry->kxkSide = WHITE;
+    else if (is_kxk_endgame(board, BLACK))
+        entry->kxkSide = BLACK;
+    else
+        entry->kxkSide = COLOR_NB;
+
+    entry->phase = 4 * popcount(piecetype_bb(board, QUEEN))
+                   + 2 * popcount(piecetype_bb(board, ROOK))
+                   + popcount(piecetypes_bb(board, KNIGHT, BISHOP));
+
+    entry->ocbCandidate = popcount(piece_bb(board, WHITE, BISHOP)) == 1
+                          && popcount(piece_bb(board, BLACK, BISHOP)) == 1;
+
+    for (color_t strongSide = WHITE; strongSide <= BLACK; ++strongSide)
+    {
+        color_t weakSide = not_color(strongSide);
+        score_t strongMat = board->stack->material[strongSide];
+        score_t weakMat = board->stack->material[weakSide];
+        int strongPawns = popcount(piece_bb(board, strongSide, PAWN));
+        int weakPawns = popcount(piece_bb(board, weakSide, PAWN));
+
+        // No Pawns and low material difference, the endgame is either drawn
+        // or very difficult to win.
+
+        if (!strongPawns && strongMat - weakMat <= BISHOP_MG_SCORE)
+            entry->scaleFactor[strongSide] =
+                (strongMat <= BISHOP_MG_SCORE)
+                    ? 0
+                    : max((int32_t)(strongMat - weakMat) * 8 / BISHOP_MG_SCORE, 0);
+        else
+            entry->scaleFactor[strongSide] = ScaleUnknown;
+
+        entry->rookEndgame[strongSide] = strongMat == ROOK_MG_SCORE && weakMat == ROOK_MG_SCORE
+                                         && strongPawns - weakPawns < 2;
+
+        entry->defaultFactor[strongSide] = min(128, 96 + 8 * strongPawns);
+    }
+
+    return (entry);
+}
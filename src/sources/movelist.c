@@ -50,23 +50,102 @@ void place_top_move(extmove_t *begin, extmove_t *end)
     *begin = tmp;
 }
 
-extmove_t *generate_piece_moves(
-    extmove_t *movelist, const board_t *board, color_t us, piecetype_t pt, bitboard_t target)
+INLINED extmove_t *generate_piece_moves(extmove_t *movelist, const board_t *board, color_t us,
+    piecetype_t pt, bitboard_t target, bool legal)
 {
     bitboard_t bb = piece_bb(board, us, pt);
     bitboard_t occupancy = occupancy_bb(board);
+    bitboard_t pinned = legal ? king_blockers(board, us) & bb : 0;
+    square_t kingSquare = get_king_square(board, us);
 
     while (bb)
     {
         square_t from = bb_pop_first_sq(&bb);
         bitboard_t b = piece_moves(pt, from, occupancy) & target;
 
+        // Pinned pieces can only move along the pin ray.
+
+        if (pinned & square_bb(from)) b &= LineBits[kingSquare][from];
+
         while (b) (movelist++)->move = create_move(from, bb_pop_first_sq(&b));
     }
 
     return (movelist);
 }
 
+INLINED extmove_t *generate_king_moves(
+    extmove_t *movelist, const board_t *board, color_t us, bitboard_t target, bool legal)
+{
+    square_t kingSquare = get_king_square(board, us);
+    bitboard_t occupancy = occupancy_bb(board) ^ square_bb(kingSquare);
+    bitboard_t theirPieces = color_bb(board, not_color(us));
+
+    for (bitboard_t b = king_moves(kingSquare) & target; b;)
+    {
+        square_t to = bb_pop_first_sq(&b);
+
+        // The King is removed from the occupancy, so that squares behind it on the line of a
+        // checking slider are seen as attacked.
+
+        if (!legal || !(attackers_list(board, to, occupancy) & theirPieces))
+            (movelist++)->move = create_move(kingSquare, to);
+    }
+
+    return (movelist);
+}
+
+INLINED extmove_t *generate_castlings(
+    extmove_t *movelist, const board_t *board, color_t us, bool legal)
+{
+    square_t kingSquare = get_king_square(board, us);
+    int kingside = (us == WHITE) ? WHITE_OO : BLACK_OO;
+    int queenside = (us == WHITE) ? WHITE_OOO : BLACK_OOO;
+
+    if (!castling_blocked(board, kingside) && (board->stack->castlings & kingside))
+    {
+        move_t move = create_castling(kingSquare, board->castlingRookSquare[kingside]);
+
+        if (!legal || move_is_legal(board, move)) (movelist++)->move = move;
+    }
+
+    if (!castling_blocked(board, queenside) && (board->stack->castlings & queenside))
+    {
+        move_t move = create_castling(kingSquare, board->castlingRookSquare[queenside]);
+
+        if (!legal || move_is_legal(board, move)) (movelist++)->move = move;
+    }
+
+    return (movelist);
+}
+
+// Removes the illegal moves of pinned Pawns and the illegal en-passant captures from the given
+// range, keeping the order of the remaining moves.
+INLINED extmove_t *remove_illegal_pawn_moves(
+    extmove_t *begin, extmove_t *end, const board_t *board, color_t us)
+{
+    bitboard_t pinned = king_blockers(board, us) & piece_bb(board, us, PAWN);
+
+    if (!pinned && board->stack->enPassantSquare == SQ_NONE) return (end);
+
+    square_t kingSquare = get_king_square(board, us);
+    extmove_t *last = begin;
+
+    for (; begin < end; ++begin)
+    {
+        move_t move = begin->move;
+
+        if ((pinned & square_bb(from_sq(move)))
+            && !sq_aligned(from_sq(move), to_sq(move), kingSquare))
+            continue;
+
+        if (move_type(move) == EN_PASSANT && !move_is_legal(board, move)) continue;
+
+        *(last++) = *begin;
+    }
+
+    return (last);
+}
+
 extmove_t *generate_pawn_capture_moves(
     extmove_t *movelist, const board_t *board, color_t us, bitboard_t theirPieces, bool inQsearch)
 {
@@ -132,21 +211,31 @@ extmove_t *generate_pawn_capture_moves(
     return (movelist);
 }
 
-extmove_t *generate_captures(extmove_t *movelist, const board_t *board, bool inQsearch)
+INLINED extmove_t *generate_capture_moves(
+    extmove_t *movelist, const board_t *board, bool inQsearch, bool legal)
 {
     color_t us = board->sideToMove;
     bitboard_t target = color_bb(board, not_color(us));
-    square_t kingSquare = get_king_square(board, us);
+    extmove_t *pawnMoves = movelist;
 
     movelist = generate_pawn_capture_moves(movelist, board, us, target, inQsearch);
 
+    if (legal) movelist = remove_illegal_pawn_moves(pawnMoves, movelist, board, us);
+
     for (piecetype_t pt = KNIGHT; pt <= QUEEN; ++pt)
-        movelist = generate_piece_moves(movelist, board, us, pt, target);
+        movelist = generate_piece_moves(movelist, board, us, pt, target, legal);
 
-    for (bitboard_t b = king_moves(kingSquare) & target; b;)
-        (movelist++)->move = create_move(kingSquare, bb_pop_first_sq(&b));
+    return (generate_king_moves(movelist, board, us, target, legal));
+}
 
-    return (movelist);
+extmove_t *generate_captures(extmove_t *movelist, const board_t *board, bool inQsearch)
+{
+    return (generate_capture_moves(movelist, board, inQsearch, false));
+}
+
+extmove_t *generate_legal_captures(extmove_t *movelist, const board_t *board, bool inQsearch)
+{
+    return (generate_capture_moves(movelist, board, inQsearch, true));
 }
 
 extmove_t *generate_quiet_pawn_moves(extmove_t *movelist, const board_t *board, color_t us)
@@ -174,30 +263,32 @@ extmove_t *generate_quiet_pawn_moves(extmove_t *movelist, const board_t *board,
     return (movelist);
 }
 
-extmove_t *generate_quiet(extmove_t *movelist, const board_t *board)
+INLINED extmove_t *generate_quiet_moves(extmove_t *movelist, const board_t *board, bool legal)
 {
     color_t us = board->sideToMove;
     bitboard_t target = ~occupancy_bb(board);
+    extmove_t *pawnMoves = movelist;
 
     movelist = generate_quiet_pawn_moves(movelist, board, us);
-    for (piecetype_t pt = KNIGHT; pt <= QUEEN; ++pt)
-        movelist = generate_piece_moves(movelist, board, us, pt, target);
 
-    square_t kingSquare = get_king_square(board, us);
-    bitboard_t b = king_moves(kingSquare) & target;
+    if (legal) movelist = remove_illegal_pawn_moves(pawnMoves, movelist, board, us);
 
-    while (b) (movelist++)->move = create_move(kingSquare, bb_pop_first_sq(&b));
+    for (piecetype_t pt = KNIGHT; pt <= QUEEN; ++pt)
+        movelist = generate_piece_moves(movelist, board, us, pt, target, legal);
 
-    int kingside = (us == WHITE) ? WHITE_OO : BLACK_OO;
-    int queenside = (us == WHITE) ? WHITE_OOO : BLACK_OOO;
+    movelist = generate_king_moves(movelist, board, us, target, legal);
 
-    if (!castling_blocked(board, kingside) && (board->stack->castlings & kingside))
-        (movelist++)->move = create_castling(kingSquare, board->castlingRookSquare[kingside]);
+    return (generate_castlings(movelist, board, us, legal));
+}
 
-    if (!castling_blocked(board, queenside) && (board->stack->castlings & queenside))
-        (movelist++)->move = create_castling(kingSquare, board->castlingRookSquare[queenside]);
+extmove_t *generate_quiet(extmove_t *movelist, const board_t *board)
+{
+    return (generate_quiet_moves(movelist, board, false));
+}
 
-    return (movelist);
+extmove_t *generate_legal_quiet(extmove_t *movelist, const board_t *board)
+{
+    return (generate_quiet_moves(movelist, board, true));
 }
 
 extmove_t *generate_classic_pawn_moves(extmove_t *movelist, const board_t *board, color_t us)
@@ -273,23 +364,11 @@ extmove_t *generate_classic(extmove_t *movelist, const board_t *board)
     movelist = generate_classic_pawn_moves(movelist, board, us);
 
     for (piecetype_t pt = KNIGHT; pt <= QUEEN; ++pt)
-        movelist = generate_piece_moves(movelist, board, us, pt, target);
-
-    square_t kingSquare = get_king_square(board, us);
-    bitboard_t b = king_moves(kingSquare) & target;
-
-    while (b) (movelist++)->move = create_move(kingSquare, bb_pop_first_sq(&b));
+        movelist = generate_piece_moves(movelist, board, us, pt, target, false);
 
-    int kingside = (us == WHITE) ? WHITE_OO : BLACK_OO;
-    int queenside = (us == WHITE) ? WHITE_OOO : BLACK_OOO;
-
-    if (!castling_blocked(board, kingside) && (board->stack->castlings & kingside))
-        (movelist++)->move = create_castling(kingSquare, board->castlingRookSquare[kingside]);
-
-    if (!castling_blocked(board, queenside) && (board->stack->castlings & queenside))
-        (movelist++)->move = create_castling(kingSquare, board->castlingRookSquare[queenside]);
+    movelist = generate_king_moves(movelist, board, us, target, false);
 
-    return (movelist);
+    return (generate_castlings(movelist, board, us, false));
 }
 
 extmove_t *generate_pawn_evasion_moves(
@@ -366,7 +445,7 @@ extmove_t *generate_pawn_evasion_moves(
     return (movelist);
 }
 
-extmove_t *generate_evasions(extmove_t *movelist, const board_t *board)
+INLINED extmove_t *generate_evasion_moves(extmove_t *movelist, const board_t *board, bool legal)
 {
     color_t us = board->sideToMove;
     square_t kingSquare = get_king_square(board, us);
@@ -379,9 +458,9 @@ extmove_t *generate_evasions(extmove_t *movelist, const board_t *board)
         sliderAttacks |= LineBits[checkSquare][kingSquare] ^ square_bb(checkSquare);
     }
 
-    bitboard_t b = king_moves(kingSquare) & ~color_bb(board, us) & ~sliderAttacks;
+    bitboard_t kingTarget = ~color_bb(board, us) & ~sliderAttacks;
 
-    while (b) (movelist++)->move = create_move(kingSquare, bb_pop_first_sq(&b));
+    movelist = generate_king_moves(movelist, board, us, kingTarget, legal);
 
     // If in check in multiple times, we know only King moves can be legal.
 
@@ -390,18 +469,32 @@ extmove_t *generate_evasions(extmove_t *movelist, const board_t *board)
     square_t checkSquare = bb_first_sq(board->stack->checkers);
     bitboard_t target = between_bb(checkSquare, kingSquare) | square_bb(checkSquare);
 
+    extmove_t *pawnMoves = movelist;
+
     movelist = generate_pawn_evasion_moves(movelist, board, target, us);
 
+    if (legal) movelist = remove_illegal_pawn_moves(pawnMoves, movelist, board, us);
+
     for (piecetype_t pt = KNIGHT; pt <= QUEEN; ++pt)
-        movelist = generate_piece_moves(movelist, board, us, pt, target);
+        movelist = generate_piece_moves(movelist, board, us, pt, target, legal);
 
     return (movelist);
 }
 
+extmove_t *generate_evasions(extmove_t *movelist, const board_t *board)
+{
+    return (generate_evasion_moves(movelist, board, false));
+}
+
+extmove_t *generate_legal_evasions(extmove_t *movelist, const board_t *board)
+{
+    return (generate_evasion_moves(movelist, board, true));
+}
+
 extmove_t *generate_all(extmove_t *movelist, const board_t *board)
 {
     color_t us = board->sideToMove;
-    bitboard_t pinned = board->stack->kingBlockers[us] & color_bb(board, us);
+    bitboard_t pinned = king_blockers(board, us) & color_bb(board, us);
     square_t kingSquare = get_king_square(board, us);
     extmove_t *current = movelist;
 
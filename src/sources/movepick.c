@@ -24,11 +24,12 @@ void movepick_init(movepick_t *mp, bool inQsearch, const board_t *board, const w
     mp->inQsearch = inQsearch;
 
     if (board->stack->checkers)
-        mp->stage = CHECK_PICK_TT + !(ttMove && move_is_pseudo_legal(board, ttMove));
+        mp->stage = CHECK_PICK_TT + !(ttMove && move_is_pseudo_legal(board, ttMove)
+                                         && move_is_legal(board, ttMove));
     else
         mp->stage = PICK_TT
                     + !(ttMove && (!inQsearch || is_capture_or_promotion(board, ttMove))
-                        && move_is_pseudo_legal(board, ttMove));
+                        && move_is_pseudo_legal(board, ttMove) && move_is_legal(board, ttMove));
 
     mp->ttMove = ttMove;
     mp->killer1 = ss->killers[0];
@@ -43,8 +44,9 @@ void movepick_init(movepick_t *mp, bool inQsearch, const board_t *board, const w
     else
         mp->counter = NO_MOVE;
 
-    mp->pieceHistory[0] = (ss - 1)->pieceHistory;
-    mp->pieceHistory[1] = (ss - 2)->pieceHistory;
+    for (int i = 0; i < ContinuationPlies; ++i)
+        mp->pieceHistory[i] = (ss - continuation_ply(i))->pieceHistory;
+
     mp->board = board;
     mp->worker = worker;
 }
@@ -79,6 +81,23 @@ static void score_captures(movepick_t *mp, extmove_t *begin, extmove_t *end)
     }
 }
 
+// Returns the continuation history score for the given piece and destination square. The
+// histories of plies 4 and 6 only get half the weight of the last two plies.
+INLINED score_t continuation_score(const movepick_t *mp, piece_t moved, square_t to)
+{
+    score_t score = 0;
+
+    for (int i = 0; i < ContinuationPlies; ++i)
+        if (mp->pieceHistory[i] != NULL)
+        {
+            score_t histScore = get_pc_history_score(*mp->pieceHistory[i], moved, to);
+
+            score += (i < 2) ? histScore : histScore / 2;
+        }
+
+    return (score);
+}
+
 static void score_quiet(movepick_t *mp, extmove_t *begin, extmove_t *end)
 {
     while (begin < end)
@@ -87,11 +106,7 @@ static void score_quiet(movepick_t *mp, extmove_t *begin, extmove_t *end)
         square_t to = to_sq(begin->move);
 
         begin->score = get_bf_history_score(mp->worker->bfHistory, moved, begin->move) / 2;
-
-        if (mp->pieceHistory[0] != NULL)
-            begin->score += get_pc_history_score(*mp->pieceHistory[0], moved, to);
-        if (mp->pieceHistory[1] != NULL)
-            begin->score += get_pc_history_score(*mp->pieceHistory[1], moved, to);
+        begin->score += continuation_score(mp, moved, to);
 
         ++begin;
     }
@@ -114,11 +129,7 @@ static void score_evasions(movepick_t *mp, extmove_t *begin, extmove_t *end)
             square_t to = to_sq(begin->move);
 
             begin->score = get_bf_history_score(mp->worker->bfHistory, moved, begin->move) / 2;
-
-            if (mp->pieceHistory[0] != NULL)
-                begin->score += get_pc_history_score(*mp->pieceHistory[0], moved, to);
-            if (mp->pieceHistory[1] != NULL)
-                begin->score += get_pc_history_score(*mp->pieceHistory[1], moved, to);
+            begin->score += continuation_score(mp, moved, to);
         }
 
         ++begin;
@@ -127,6 +138,8 @@ static void score_evasions(movepick_t *mp, extmove_t *begin, extmove_t *end)
 
 move_t movepick_next_move(movepick_t *mp, bool skipQuiets)
 {
+    mp->see = NO_SCORE;
+
 __top:
 
     switch (mp->stage)
@@ -136,7 +149,7 @@ __top:
 
         case GEN_INSTABLE:
             ++mp->stage;
-            mp->list.last = generate_captures(mp->list.moves, mp->board, mp->inQsearch);
+            mp->list.last = generate_legal_captures(mp->list.moves, mp->board, mp->inQsearch);
             score_captures(mp, mp->list.moves, mp->list.last);
             mp->cur = mp->badCaptures = mp->list.moves;
             // Fallthrough
@@ -146,8 +159,20 @@ __top:
             {
                 place_top_move(mp->cur, mp->list.last);
 
-                if (mp->cur->move != mp->ttMove && see_greater_than(mp->board, mp->cur->move, 0))
-                    return ((mp->cur++)->move);
+                if (mp->cur->move != mp->ttMove)
+                {
+                    // Compute the exact SEE score once, so that the search
+                    // can reuse it for its own pruning thresholds.
+
+                    STATS_ADD(get_worker(mp->board), StatSeeCall);
+                    mp->cur->see = see_value(mp->board, mp->cur->move);
+
+                    if (mp->cur->see >= 0)
+                    {
+                        mp->see = mp->cur->see;
+                        return ((mp->cur++)->move);
+                    }
+                }
 
                 *(mp->badCaptures++) = *(mp->cur++);
             }
@@ -164,21 +189,24 @@ __top:
         case PICK_KILLER1:
             ++mp->stage;
             if (mp->killer1 && mp->killer1 != mp->ttMove
-                && move_is_pseudo_legal(mp->board, mp->killer1))
+                && move_is_pseudo_legal(mp->board, mp->killer1)
+                && move_is_legal(mp->board, mp->killer1))
                 return (mp->killer1);
             // Fallthrough
 
         case PICK_KILLER2:
             ++mp->stage;
             if (mp->killer2 && mp->killer2 != mp->ttMove && mp->killer2 != mp->killer1
-                && move_is_pseudo_legal(mp->board, mp->killer2))
+                && move_is_pseudo_legal(mp->board, mp->killer2)
+                && move_is_legal(mp->board, mp->killer2))
                 return (mp->killer2);
             // Fallthrough
 
         case PICK_COUNTER:
             ++mp->stage;
             if (mp->counter && mp->counter != mp->ttMove && mp->counter != mp->killer1
-                && mp->counter != mp->killer2 && move_is_pseudo_legal(mp->board, mp->counter))
+                && mp->counter != mp->killer2 && move_is_pseudo_legal(mp->board, mp->counter)
+                && move_is_legal(mp->board, mp->counter))
                 return (mp->counter);
             // Fallthrough
 
@@ -186,7 +214,7 @@ __top:
             ++mp->stage;
             if (!skipQuiets)
             {
-                mp->list.last = generate_quiet(mp->cur, mp->board);
+                mp->list.last = generate_legal_quiet(mp->cur, mp->board);
                 score_quiet(mp, mp->cur, mp->list.last);
             }
             // Fallthrough
@@ -210,7 +238,11 @@ __top:
         case PICK_BAD_INSTABLE:
             while (mp->cur < mp->badCaptures)
             {
-                if (mp->cur->move != mp->ttMove) return ((mp->cur++)->move);
+                if (mp->cur->move != mp->ttMove)
+                {
+                    mp->see = mp->cur->see;
+                    return ((mp->cur++)->move);
+                }
 
                 mp->cur++;
             }
@@ -218,7 +250,7 @@ __top:
 
         case CHECK_GEN_ALL:
             ++mp->stage;
-            mp->list.last = generate_evasions(mp->list.moves, mp->board);
+            mp->list.last = generate_legal_evasions(mp->list.moves, mp->board);
             score_evasions(mp, mp->list.moves, mp->list.last);
             mp->cur = mp->list.moves;
             // Fallthrough
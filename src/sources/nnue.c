@@ -0,0 +1,295 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "nnue.h"
+#include "board.h"
+#include "evaluate.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(USE_AVX2)
+#include <immintrin.h>
+#elif defined(USE_SSE2)
+#include <emmintrin.h>
+#endif
+
+// Quantization factors of the hidden layer activation and the output weights,
+// and the scale used to convert the network output to a score.
+enum
+{
+    NnueQA = 255,
+    NnueQB = 64,
+    NnueScale = 400
+};
+
+// Max number of moves we walk back to find a computed accumulator. Past that
+// point, refreshing the accumulator from scratch is cheaper.
+#define NNUE_MAX_UPDATES 32
+
+#define NNUE_MAGIC "STASHNN"
+#define NNUE_VERSION 1
+
+// Struct for the header of the network files
+typedef struct nnue_header_s
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t hidden;
+} nnue_header_t;
+
+bool NnueLoaded = false;
+
+static int16_t FeatureWeights[NNUE_INPUTS * NNUE_HIDDEN] __attribute__((aligned(64)));
+static int16_t FeatureBiases[NNUE_HIDDEN] __attribute__((aligned(64)));
+static int16_t OutputWeights[2 * NNUE_HIDDEN] __attribute__((aligned(64)));
+static int32_t OutputBias;
+
+const char *nnue_load(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    nnue_header_t header;
+    int extra;
+
+    NnueLoaded = false;
+
+    if (f == NULL) return ("unable to open file");
+
+    // The weights are stored as little-endian integers, in the same order as
+    // in memory.
+
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, NNUE_MAGIC, 8))
+    {
+        fclose(f);
+        return ("not a network file");
+    }
+
+    if (header.version != NNUE_VERSION || header.inputs != NNUE_INPUTS
+        || header.hidden != NNUE_HIDDEN)
+    {
+        fclose(f);
+        return ("unsupported network architecture");
+    }
+
+    if (fread(FeatureWeights, sizeof(FeatureWeights), 1, f) != 1
+        || fread(FeatureBiases, sizeof(FeatureBiases), 1, f) != 1
+        || fread(OutputWeights, sizeof(OutputWeights), 1, f) != 1
+        || fread(&OutputBias, sizeof(OutputBias), 1, f) != 1)
+    {
+        fclose(f);
+        return ("truncated network file");
+    }
+
+    extra = fgetc(f);
+    fclose(f);
+
+    if (extra != EOF) return ("trailing data in network file");
+
+    NnueLoaded = true;
+    return (NULL);
+}
+
+void nnue_unload(void) { NnueLoaded = false; }
+
+// Returns the weight column for the given piece, square and perspective.
+INLINED const int16_t *feature_column(color_t perspective, piece_t piece, square_t square)
+{
+    int index = (piece_color(piece) != perspective) * 6 + piece_type(piece) - PAWN;
+
+    index = index * SQUARE_NB + relative_sq(square, perspective);
+    return (FeatureWeights + index * NNUE_HIDDEN);
+}
+
+// Adds the given weight column to the accumulator values.
+INLINED void vec_add(int16_t *restrict values, const int16_t *restrict column)
+{
+#if defined(USE_AVX2)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i c = _mm256_load_si256((const __m256i *)(column + i));
+
+        _mm256_storeu_si256((__m256i *)(values + i), _mm256_add_epi16(v, c));
+    }
+#elif defined(USE_SSE2)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i c = _mm_load_si128((const __m128i *)(column + i));
+
+        _mm_storeu_si128((__m128i *)(values + i), _mm_add_epi16(v, c));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i) values[i] += column[i];
+#endif
+}
+
+// Subtracts the given weight column from the accumulator values.
+INLINED void vec_sub(int16_t *restrict values, const int16_t *restrict column)
+{
+#if defined(USE_AVX2)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i c = _mm256_load_si256((const __m256i *)(column + i));
+
+        _mm256_storeu_si256((__m256i *)(values + i), _mm256_sub_epi16(v, c));
+    }
+#elif defined(USE_SSE2)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i c = _mm_load_si128((const __m128i *)(column + i));
+
+        _mm_storeu_si128((__m128i *)(values + i), _mm_sub_epi16(v, c));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i) values[i] -= column[i];
+#endif
+}
+
+// Returns the dot product of the clipped accumulator values with the given output weights.
+INLINED int32_t vec_output(const int16_t *restrict values, const int16_t *restrict weights)
+{
+#if defined(USE_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(NnueQA);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i w = _mm256_load_si256((const __m256i *)(weights + i));
+
+        v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+    }
+
+    __m128i sum128 =
+        _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+    return (_mm_cvtsi128_si32(sum128));
+#elif defined(USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(NnueQA);
+    __m128i sum = _mm_setzero_si128();
+
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i w = _mm_load_si128((const __m128i *)(weights + i));
+
+        v = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return (_mm_cvtsi128_si32(sum));
+#else
+    int32_t sum = 0;
+
+    for (int i = 0; i < NNUE_HIDDEN; ++i) sum += clamp(values[i], 0, NnueQA) * weights[i];
+
+    return (sum);
+#endif
+}
+
+// Computes the accumulator from scratch for the current position.
+static void accumulator_refresh(const board_t *board, nnue_accumulator_t *acc)
+{
+    for (color_t c = WHITE; c <= BLACK; ++c)
+    {
+        memcpy(acc->values[c], FeatureBiases, sizeof(FeatureBiases));
+
+        for (bitboard_t b = occupancy_bb(board); b;)
+        {
+            square_t sq = bb_pop_first_sq(&b);
+
+            vec_add(acc->values[c], feature_column(c, piece_on(board, sq), sq));
+        }
+    }
+
+    acc->computed = true;
+}
+
+// Computes the accumulator of the given stack from the previous one.
+static void accumulator_apply(boardstack_t *stack)
+{
+    const dirty_pieces_t *dp = &stack->dirtyPieces;
+    nnue_accumulator_t *acc = &stack->accumulator;
+
+    memcpy(acc->values, stack->prev->accumulator.values, sizeof(acc->values));
+
+    for (color_t c = WHITE; c <= BLACK; ++c)
+        for (int i = 0; i < dp->count; ++i)
+        {
+            if (dp->from[i] != SQ_NONE)
+                vec_sub(acc->values[c], feature_column(c, dp->piece[i], dp->from[i]));
+
+            if (dp->to[i] != SQ_NONE)
+                vec_add(acc->values[c], feature_column(c, dp->piece[i], dp->to[i]));
+        }
+
+    acc->computed = true;
+}
+
+// Brings the accumulator of the current position up to date, by replaying the
+// moves played since the last computed accumulator.
+static void accumulator_update(const board_t *board)
+{
+    boardstack_t *path[NNUE_MAX_UPDATES];
+    boardstack_t *stack = board->stack;
+    int count = 0;
+
+    while (!stack->accumulator.computed)
+    {
+        if (count == NNUE_MAX_UPDATES || stack->prev == NULL)
+        {
+            accumulator_refresh(board, &board->stack->accumulator);
+            return;
+        }
+
+        path[count++] = stack;
+        stack = stack->prev;
+    }
+
+    while (count) accumulator_apply(path[--count]);
+}
+
+score_t nnue_evaluate(const board_t *board)
+{
+    const color_t us = board->sideToMove;
+    const nnue_accumulator_t *acc = &board->stack->accumulator;
+
+    accumulator_update(board);
+
+    int32_t output = OutputBias;
+
+    output += vec_output(acc->values[us], OutputWeights);
+    output += vec_output(acc->values[not_color(us)], OutputWeights + NNUE_HIDDEN);
+
+    // Keep the score out of the mate range, so that it can't be mistaken for
+    // a proven result.
+
+    int score = (int)((int64_t)output * NnueScale / (NnueQA * NnueQB));
+
+    return ((score_t)clamp(score, -VICTORY + 1, VICTORY - 1));
+}
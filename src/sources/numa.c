@@ -0,0 +1,163 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include "numa.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// clang-format off
+
+const char *const ThreadBindingNames[BINDING_NB + 1] = {
+    "None",
+    "Node",
+    "Core",
+    NULL
+};
+
+// clang-format on
+
+// Reads a list of ranges like "0-3,8-11" from the given file, and stores the listed values.
+// Returns the number of values read.
+static size_t read_range_list(const char *path, int *values, size_t maxValues)
+{
+    FILE *f = fopen(path, "r");
+    size_t count = 0;
+    int first, last;
+    char sep;
+
+    if (f == NULL) return (0);
+
+    while (fscanf(f, "%d", &first) == 1)
+    {
+        last = first;
+
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-')
+        {
+            if (fscanf(f, "%d", &last) != 1) break;
+            if (fscanf(f, "%c", &sep) != 1) sep = '\n';
+        }
+
+        for (int i = first; i <= last && count < maxValues; ++i) values[count++] = i;
+
+        if (sep != ',') break;
+    }
+
+    fclose(f);
+    return (count);
+}
+
+unsigned long numa_online_mask(void)
+{
+    int nodes[64];
+    size_t count = read_range_list("/sys/devices/system/node/online", nodes, 64);
+    unsigned long mask = 0;
+
+    for (size_t i = 0; i < count; ++i)
+        if (nodes[i] < 64) mask |= 1ul << nodes[i];
+
+    return (mask ? mask : 1);
+}
+
+#ifdef __linux__
+
+void *numa_alloc(size_t size)
+{
+    // Use a fresh mapping, since memory recycled by malloc() might already
+    // have been touched by another thread.
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return (ptr == MAP_FAILED ? NULL : ptr);
+}
+
+void numa_free(void *ptr, size_t size)
+{
+    if (ptr != NULL) munmap(ptr, size);
+}
+
+int numa_bind_thread(thread_binding_t binding, size_t idx)
+{
+    cpu_set_t allowed, target;
+    int cpus[CPU_SETSIZE];
+    size_t count = 0;
+    int bound;
+
+    if (binding == BindNone || sched_getaffinity(0, sizeof(allowed), &allowed)) return (-1);
+
+    CPU_ZERO(&target);
+
+    if (binding == BindNode)
+    {
+        // Spread workers over the online nodes in a round-robin fashion, and
+        // let them run on any allowed CPU of their node.
+
+        int nodes[64];
+        size_t nodeCount = read_range_list("/sys/devices/system/node/online", nodes, 64);
+        char path[64];
+
+        if (nodeCount <= 1) return (-1);
+
+        bound = nodes[idx % nodeCount];
+        sprintf(path, "/sys/devices/system/node/node%d/cpulist", bound);
+        count = read_range_list(path, cpus, CPU_SETSIZE);
+
+        for (size_t i = 0; i < count; ++i)
+            if (CPU_ISSET(cpus[i], &allowed)) CPU_SET(cpus[i], &target);
+    }
+    else
+    {
+        // Assign cores in order among the CPUs we're allowed to run on.
+
+        for (int i = 0; i < CPU_SETSIZE; ++i)
+            if (CPU_ISSET(i, &allowed)) cpus[count++] = i;
+
+        if (count == 0) return (-1);
+
+        bound = cpus[idx % count];
+        CPU_SET(bound, &target);
+    }
+
+    if (CPU_COUNT(&target) == 0 || sched_setaffinity(0, sizeof(target), &target)) return (-1);
+
+    return (bound);
+}
+
+#else
+
+void *numa_alloc(size_t size) { return (calloc(1, size)); }
+
+void numa_free(void *ptr, size_t size)
+{
+    (void)size;
+    free(ptr);
+}
+
+int numa_bind_thread(thread_binding_t binding, size_t idx)
+{
+    (void)binding;
+    (void)idx;
+    return (-1);
+}
+
+#endif
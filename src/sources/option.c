@@ -59,6 +59,7 @@ void quit_option_list(option_list_t *list)
                 // Fallthrough
 
             case OptionString:
+                free(cur->def);
                 free(*(char **)cur->data);
                 *(char **)cur->data = NULL;
                 break;
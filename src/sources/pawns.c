@@ -60,6 +60,30 @@ const scorepair_t DefenderBonus[RANK_NB] = {
     0
 };
 
+// Passed Pawn King proximity terms
+
+const scorepair_t PP_OurKingProximity[8] = {
+    0,
+    SPAIR(  -8,  37),
+    SPAIR( -18,  27),
+    SPAIR( -14,  -1),
+    SPAIR(  -8, -15),
+    SPAIR(   0, -18),
+    SPAIR(  20, -24),
+    SPAIR(  -1, -24)
+};
+
+const scorepair_t PP_TheirKingProximity[8] = {
+    0,
+    SPAIR( -51,-111),
+    SPAIR(  12, -25),
+    SPAIR(   1,   3),
+    SPAIR(   3,  18),
+    SPAIR(   4,  29),
+    SPAIR(   5,  37),
+    SPAIR(  -4,  32)
+};
+
 // clang-format on
 
 scorepair_t evaluate_passed(
@@ -185,12 +209,46 @@ scorepair_t evaluate_doubled_isolated(bitboard_t bb, color_t us __attribute__((u
     return (ret);
 }
 
+scorepair_t evaluate_passed_pos(const board_t *board, const pawn_entry_t *entry, color_t us)
+{
+    scorepair_t ret = 0;
+    square_t ourKing = get_king_square(board, us);
+    square_t theirKing = get_king_square(board, not_color(us));
+    bitboard_t bb = entry->passed[us];
+
+    while (bb)
+    {
+        square_t sq = bb_pop_first_sq(&bb);
+
+        // Give a bonus/penalty based on how close is our King and their King
+        // from the Pawn.
+
+        int ourDistance = SquareDistance[ourKing][sq];
+        int theirDistance = SquareDistance[theirKing][sq];
+
+        ret += PP_OurKingProximity[ourDistance];
+        ret += PP_TheirKingProximity[theirDistance];
+
+        TRACE_ADD(IDX_PP_OUR_KING_PROX + ourDistance - 1, us, 1);
+        TRACE_ADD(IDX_PP_THEIR_KING_PROX + theirDistance - 1, us, 1);
+    }
+
+    return (ret);
+}
+
 pawn_entry_t *pawn_probe(const board_t *board)
 {
 #ifndef TUNE
-    pawn_entry_t *entry = get_worker(board)->pawnTable + (board->stack->pawnKey % PawnTableSize);
+    worker_t *worker = get_worker(board);
+    pawn_entry_t *entry = worker->pawnTable + (board->stack->pawnKey % worker->pawnTableSize);
+
+    worker->pawnProbes++;
 
-    if (entry->key == board->stack->pawnKey) return (entry);
+    if (entry->key == board->stack->pawnKey)
+    {
+        worker->pawnHits++;
+        return (entry);
+    }
 
 #else
     static pawn_entry_t e;
@@ -201,6 +259,7 @@ pawn_entry_t *pawn_probe(const board_t *board)
     entry->value = 0;
     entry->attackSpan[WHITE] = entry->attackSpan[BLACK] = 0;
     entry->passed[WHITE] = entry->passed[BLACK] = 0;
+    entry->kingSquare[WHITE] = entry->kingSquare[BLACK] = SQ_NONE;
 
     const bitboard_t wpawns = piece_bb(board, WHITE, PAWN);
     const bitboard_t bpawns = piece_bb(board, BLACK, PAWN);
@@ -221,3 +280,19 @@ pawn_entry_t *pawn_probe(const board_t *board)
 
     return (entry);
 }
+
+scorepair_t pawn_king_value(const board_t *board, pawn_entry_t *entry)
+{
+    const square_t wksq = get_king_square(board, WHITE);
+    const square_t bksq = get_king_square(board, BLACK);
+
+    if (entry->kingSquare[WHITE] != wksq || entry->kingSquare[BLACK] != bksq)
+    {
+        entry->kingSquare[WHITE] = wksq;
+        entry->kingSquare[BLACK] = bksq;
+        entry->kingValue = evaluate_passed_pos(board, entry, WHITE);
+        entry->kingValue -= evaluate_passed_pos(board, entry, BLACK);
+    }
+
+    return (entry->kingValue);
+}
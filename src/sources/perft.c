@@ -0,0 +1,159 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "perft.h"
+#include "movelist.h"
+#include "timeman.h"
+#include "uci.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Shared state of the current perft run
+static perft_entry_t *PerftTable;
+static size_t PerftTableSize;
+static _Atomic size_t PerftNextMove;
+static uint64_t PerftCounts[256];
+
+// Returns the cached node count for the given key and depth, or 0 if not found.
+INLINED uint64_t perft_probe(hashkey_t key, unsigned int depth)
+{
+    const perft_entry_t *entry = &PerftTable[mul_hi64(key, PerftTableSize)];
+    hashkey_t entryKey = entry->key;
+    uint64_t data = entry->data;
+
+    // The depth is stored in the low byte of the data.
+
+    if ((entryKey ^ data) != key || (data & 0xFF) != depth) return (0);
+
+    return (data >> 8);
+}
+
+// Stores the node count for the given key and depth.
+INLINED void perft_store(hashkey_t key, unsigned int depth, uint64_t nodes)
+{
+    perft_entry_t *entry = &PerftTable[mul_hi64(key, PerftTableSize)];
+    uint64_t data = (nodes << 8) | depth;
+
+    entry->key = key ^ data;
+    entry->data = data;
+}
+
+uint64_t perft(board_t *board, unsigned int depth)
+{
+    if (depth == 0) return (1);
+
+    movelist_t list;
+    list_all(&list, board);
+
+    // Bulk counting: the perft number at depth 1 equals the number of legal moves.
+    // Large perft speedup from not having to do the make/unmake move stuff.
+
+    if (depth == 1) return (movelist_size(&list));
+
+    const hashkey_t key = board->stack->boardKey;
+    uint64_t sum;
+
+    // Subtrees at depth 2 are too cheap to be worth a cache miss.
+
+    if (PerftTable != NULL && depth > 2 && (sum = perft_probe(key, depth)) != 0) return (sum);
+
+    sum = 0;
+
+    for (extmove_t *extmove = list.moves; extmove < list.last; ++extmove)
+    {
+        do_move(board, extmove->move);
+        sum += perft(board, depth - 1);
+        undo_move(board, extmove->move);
+    }
+
+    if (PerftTable != NULL && depth > 2) perft_store(key, depth, sum);
+
+    return (sum);
+}
+
+void perft_worker(worker_t *worker)
+{
+    board_t *board = &worker->board;
+    const unsigned int depth = (unsigned int)SearchParams.perft;
+    movelist_t list;
+    size_t k;
+
+    // All workers generate the root moves in the same order, so that they can
+    // be referred to by their index.
+
+    list_all(&list, board);
+
+    while ((k = PerftNextMove++) < movelist_size(&list))
+    {
+        move_t move = list.moves[k].move;
+
+        do_move(board, move);
+        PerftCounts[k] = perft(board, depth - 1);
+        undo_move(board, move);
+    }
+}
+
+void perft_main(worker_t *worker)
+{
+    board_t *board = &worker->board;
+    clock_t time = chess_clock();
+    movelist_t list;
+    uint64_t nodes = 0;
+
+    list_all(&list, board);
+
+    // The perft hash is only allocated for the duration of the run, with the
+    // same size as the TT.
+
+    PerftTableSize = (size_t)Options.hash * 1024 * 1024 / sizeof(perft_entry_t);
+    PerftTable = calloc(PerftTableSize, sizeof(perft_entry_t));
+    PerftNextMove = 0;
+
+    if (PerftTable == NULL)
+        puts("info string Unable to allocate perft hash, running without it");
+
+    // Depth 1 perfts are just a count of the root moves.
+
+    if (SearchParams.perft == 1)
+        for (size_t k = 0; k < movelist_size(&list); ++k) PerftCounts[k] = 1;
+    else
+    {
+        wpool_start_workers(&WPool);
+        perft_worker(worker);
+        wpool_wait_search_end(&WPool);
+    }
+
+    for (size_t k = 0; k < movelist_size(&list); ++k)
+    {
+        if (SearchParams.divide)
+            printf("%s: %" FMT_INFO "\n", move_to_str(list.moves[k].move, board->chess960),
+                (info_t)PerftCounts[k]);
+
+        nodes += PerftCounts[k];
+    }
+
+    free(PerftTable);
+    PerftTable = NULL;
+
+    time = chess_clock() - time;
+
+    uint64_t nps = nodes / (time + !time) * 1000;
+
+    printf("info nodes %" FMT_INFO " nps %" FMT_INFO " time %" FMT_INFO "\n", (info_t)nodes,
+        (info_t)nps, (info_t)time);
+}
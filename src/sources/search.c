@@ -20,6 +20,8 @@
 #include "board.h"
 #include "evaluate.h"
 #include "movepick.h"
+#include "perft.h"
+#include "stats.h"
 #include "timeman.h"
 #include "tt.h"
 #include "types.h"
@@ -31,6 +33,12 @@
 int Reductions[64][64];
 int Pruning[2][7];
 
+// Tables for the Skip helper schedule. Helper workers search iterations by
+// blocks of SkipSize[i] depths, skipping every other block, with the blocks
+// shifted by SkipPhase[i] depths.
+const int SkipSize[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int SkipPhase[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
 void init_search_tables(void)
 {
     for (int d = 1; d < 64; ++d)
@@ -43,29 +51,27 @@ void init_search_tables(void)
     }
 }
 
-uint64_t perft(board_t *board, unsigned int depth)
+// Returns the depth to search for the given worker and iteration, or -1 if the iteration should
+// be skipped.
+int iteration_depth(const worker_t *worker, int iterDepth)
 {
-    if (depth == 0) return (1);
+    // The main worker searches all iterations, and helpers never skip the
+    // last one, since they keep searching it until the main worker is done.
 
-    movelist_t list;
-    list_all(&list, board);
+    if (!worker->idx || iterDepth >= SearchParams.depth - 1) return (iterDepth);
 
-    // Bulk counting: the perft number at depth 1 equals the number of legal moves.
-    // Large perft speedup from not having to do the make/unmake move stuff.
+    if (Options.helperSchedule == ScheduleSkip)
+    {
+        const size_t i = (worker->idx - 1) % 20;
 
-    if (depth == 1) return (movelist_size(&list));
+        return (((iterDepth + SkipPhase[i]) / SkipSize[i]) % 2 ? -1 : iterDepth);
+    }
 
-    uint64_t sum = 0;
-    boardstack_t stack;
+    // With the Offset schedule, every other helper searches one ply deeper.
 
-    for (extmove_t *extmove = list.moves; extmove < list.last; ++extmove)
-    {
-        do_move(board, extmove->move, &stack);
-        sum += perft(board, depth - 1);
-        undo_move(board, extmove->move);
-    }
+    if (Options.helperSchedule == ScheduleOffset) return (iterDepth + (int)(worker->idx & 1));
 
-    return (sum);
+    return (iterDepth);
 }
 
 void update_pv(move_t *pv, move_t bestmove, move_t *subPv)
@@ -84,16 +90,8 @@ void main_worker_search(worker_t *worker)
 
     if (SearchParams.perft)
     {
-        clock_t time = chess_clock();
-        uint64_t nodes = perft(board, (unsigned int)SearchParams.perft);
-
-        time = chess_clock() - time;
-
-        uint64_t nps = nodes / (time + !time) * 1000;
-
-        printf("info nodes %" FMT_INFO " nps %" FMT_INFO " time %" FMT_INFO "\n", (info_t)nodes,
-            (info_t)nps, (info_t)time);
-
+        perft_main(worker);
+        free(worker->rootMoves);
         return;
     }
 
@@ -114,6 +112,7 @@ void main_worker_search(worker_t *worker)
 
         if (SearchParams.nodes == 0) --SearchParams.nodes;
 
+        timer_start();
         wpool_start_workers(&WPool);
         worker_search(worker);
     }
@@ -122,23 +121,23 @@ void main_worker_search(worker_t *worker)
     // before the GUI sends us the "stop" in infinite mode
     // or "ponderhit" in ponder mode.
 
-    while (!WPool.stop && (WPool.ponder || SearchParams.infinite))
-        ;
+    wpool_wait_stop(&WPool, &SearchParams);
 
     WPool.stop = true;
+    timer_stop();
 
     if (worker->rootCount == 0)
     {
         puts("bestmove 0000");
         fflush(stdout);
         free(worker->rootMoves);
-        free_boardstack(worker->stack);
         return;
     }
 
     // Wait for all threads to stop searching.
 
     wpool_wait_search_end(&WPool);
+    STATS_MERGE(&WPool);
 
     printf("bestmove %s", move_to_str(worker->rootMoves->move, board->chess960));
 
@@ -149,17 +148,16 @@ void main_worker_search(worker_t *worker)
 
     if (ponderMove == NO_MOVE)
     {
-        boardstack_t stack;
-        tt_entry_t *entry;
+        tt_entry_t ttData;
         bool found;
 
-        do_move(board, worker->rootMoves->move, &stack);
-        entry = tt_probe(board->stack->boardKey, &found);
+        do_move(board, worker->rootMoves->move);
+        tt_probe(board->stack->boardKey, &found, &ttData);
         undo_move(board, worker->rootMoves->move);
 
         if (found)
         {
-            ponderMove = entry->bestmove;
+            ponderMove = ttData.bestmove;
 
             // Take care of data races !
 
@@ -174,19 +172,25 @@ void main_worker_search(worker_t *worker)
     fflush(stdout);
 
     free(worker->rootMoves);
-    free_boardstack(worker->stack);
 }
 
 void worker_search(worker_t *worker)
 {
     board_t *board = &worker->board;
 
-    // Reset all history related stuff.
+    if (SearchParams.perft)
+    {
+        perft_worker(worker);
+        free(worker->rootMoves);
+        return;
+    }
+
+    // Age the history tables from the previous search instead of clearing
+    // them. They are only reset by ucinewgame.
 
-    memset(worker->bfHistory, 0, sizeof(butterfly_history_t));
-    memset(worker->ctHistory, 0, sizeof(continuation_history_t));
-    memset(worker->cmHistory, 0, sizeof(countermove_history_t));
-    memset(worker->capHistory, 0, sizeof(capture_history_t));
+    age_history(&worker->bfHistory[0][0], sizeof(butterfly_history_t) / sizeof(int16_t));
+    age_history(&worker->ctHistory[0][0][0][0], sizeof(continuation_history_t) / sizeof(int16_t));
+    age_history(&worker->capHistory[0][0][0], sizeof(capture_history_t) / sizeof(int16_t));
     worker->verifPlies = 0;
 
     // Clamp MultiPV to the maximal number of lines available
@@ -197,6 +201,9 @@ void worker_search(worker_t *worker)
     {
         bool hasSearchAborted;
         searchstack_t sstack[256];
+        const int rootDepth = iteration_depth(worker, iterDepth);
+
+        if (rootDepth < 0) continue;
 
         // Reset the search stack data
 
@@ -210,7 +217,7 @@ void worker_search(worker_t *worker)
             worker->seldepth = 0;
 
             score_t alpha, beta, delta;
-            int depth = iterDepth;
+            int depth = rootDepth;
             score_t pvScore = worker->rootMoves[worker->pvLine].prevScore;
 
             // Don't set aspiration window bounds for low depths, as the scores are
@@ -230,7 +237,7 @@ void worker_search(worker_t *worker)
             }
 
 __retry:
-            search(board, depth + 1, alpha, beta, &sstack[2], true);
+            search(board, depth + 1, alpha, beta, &sstack[RootStackOffset], true);
 
             // Catch search aborting
 
@@ -279,7 +286,7 @@ __retry:
 
             if (bound == UPPER_BOUND)
             {
-                depth = iterDepth;
+                depth = rootDepth;
                 beta = (alpha + beta) / 2;
                 alpha = max(-INF_SCORE, (int)pvScore - delta);
                 delta += delta / 4;
@@ -287,7 +294,7 @@ __retry:
             }
             else if (bound == LOWER_BOUND)
             {
-                depth -= (depth > iterDepth / 2);
+                depth -= (depth > rootDepth / 2);
                 beta = min(INF_SCORE, (int)pvScore + delta);
                 delta += delta / 4;
                 goto __retry;
@@ -325,11 +332,7 @@ __retry:
         if (worker->idx && iterDepth == SearchParams.depth - 1) --iterDepth;
     }
 
-    if (worker->idx)
-    {
-        free(worker->rootMoves);
-        free_boardstack(worker->stack);
-    }
+    if (worker->idx) free(worker->rootMoves);
 }
 
 score_t search(
@@ -350,7 +353,7 @@ score_t search(
     move_t pv[256];
     score_t bestScore = -INF_SCORE;
 
-    if (!worker->idx) check_time();
+    if (!worker->idx) check_node_limit();
 
     if (pvNode && worker->seldepth < ss->plies + 1) worker->seldepth = ss->plies + 1;
 
@@ -380,15 +383,19 @@ score_t search(
     move_t ttMove = NO_MOVE;
     bool found;
     hashkey_t key = board->stack->boardKey ^ ((hashkey_t)ss->excludedMove << 16);
-    tt_entry_t *entry = tt_probe(key, &found);
+    tt_entry_t ttData;
+    tt_entry_t *entry = tt_probe(key, &found, &ttData);
     score_t eval;
 
+    worker->ttProbes++;
+    worker->ttHits += found;
+
     if (found)
     {
-        ttScore = score_from_tt(entry->score, ss->plies);
-        ttBound = entry->genbound & 3;
-        ttDepth = entry->depth;
-        ttMove = entry->bestmove;
+        ttScore = score_from_tt(ttData.score, ss->plies);
+        ttBound = ttData.genbound & 3;
+        ttDepth = ttData.depth;
+        ttMove = ttData.bestmove;
 
         if (ttDepth >= depth && !pvNode)
             if (((ttBound & LOWER_BOUND) && ttScore >= beta)
@@ -397,6 +404,7 @@ score_t search(
                 if ((ttBound & LOWER_BOUND) && !is_capture_or_promotion(board, ttMove))
                     update_quiet_history(board, depth, ttMove, NULL, 0, ss);
 
+                STATS_ADD(worker, StatTTCutoff);
                 return (ttScore);
             }
     }
@@ -412,13 +420,13 @@ score_t search(
     }
     else if (found)
     {
-        eval = ss->staticEval = entry->eval;
+        eval = ss->staticEval = ttData.eval;
 
         if (ttBound & (ttScore > eval ? LOWER_BOUND : UPPER_BOUND)) eval = ttScore;
     }
     else
     {
-        eval = ss->staticEval = evaluate(board);
+        eval = ss->staticEval = evaluate_cached(board);
 
         // Save the eval in TT so that other workers won't have to recompute it.
 
@@ -432,28 +440,33 @@ score_t search(
     // Razoring.
 
     if (!pvNode && depth == 1 && ss->staticEval + 150 <= alpha)
+    {
+        STATS_ADD(worker, StatRazoring);
         return (qsearch(board, alpha, beta, ss, false));
+    }
 
     improving = ss->plies >= 2 && ss->staticEval > (ss - 2)->staticEval;
 
     // Futility Pruning.
 
     if (!pvNode && depth <= 8 && eval - 80 * (depth - improving) >= beta && eval < VICTORY)
+    {
+        STATS_ADD(worker, StatFutilityNode);
         return (eval);
+    }
 
     // Null move pruning.
 
     if (!pvNode && depth >= 3 && ss->plies >= worker->verifPlies && !ss->excludedMove
         && eval >= beta && eval >= ss->staticEval && board->stack->material[board->sideToMove])
     {
-        boardstack_t stack;
-
         int R = 3 + min((eval - beta) / 128, 3) + (depth / 4);
 
         ss->currentMove = NULL_MOVE;
         ss->pieceHistory = NULL;
 
-        do_null_move(board, &stack);
+        STATS_ADD(worker, StatNullMoveTry);
+        do_null_move(board);
         score_t score = -search(board, depth - R, -beta, -beta + 1, ss + 1, false);
         undo_null_move(board);
 
@@ -465,7 +478,11 @@ score_t search(
 
             // Do not trust win claims.
 
-            if (worker->verifPlies || (depth <= 10 && abs(beta) < VICTORY)) return (score);
+            if (worker->verifPlies || (depth <= 10 && abs(beta) < VICTORY))
+            {
+                STATS_ADD(worker, StatNullMoveCutoff);
+                return (score);
+            }
 
             // Zugzwang checking.
 
@@ -475,7 +492,11 @@ score_t search(
 
             worker->verifPlies = 0;
 
-            if (zzscore >= beta) return (score);
+            if (zzscore >= beta)
+            {
+                STATS_ADD(worker, StatNullMoveCutoff);
+                return (score);
+            }
         }
     }
 
@@ -509,7 +530,7 @@ __main_loop:
         }
         else
         {
-            if (!move_is_legal(board, currmove) || currmove == ss->excludedMove) continue;
+            if (currmove == ss->excludedMove) continue;
         }
 
         moveCount++;
@@ -520,19 +541,29 @@ __main_loop:
         {
             // Late Move Pruning.
 
-            if (depth <= 6 && moveCount > Pruning[improving][depth]) skipQuiets = true;
+            if (depth <= 6 && moveCount > Pruning[improving][depth] && !skipQuiets)
+            {
+                STATS_ADD(worker, StatLateMovePruning);
+                skipQuiets = true;
+            }
 
             // Futility Pruning.
 
-            if (depth <= 4 && !inCheck && isQuiet && eval + 240 + 80 * depth <= alpha)
+            if (depth <= 4 && !inCheck && isQuiet && eval + 240 + 80 * depth <= alpha
+                && !skipQuiets)
+            {
+                STATS_ADD(worker, StatFutilityMove);
                 skipQuiets = true;
+            }
 
             // SEE Pruning.
 
             if (depth <= 7
-                && !see_greater_than(
-                    board, currmove, (isQuiet ? -80 * depth : -25 * depth * depth)))
+                && !movepick_see_ge(&mp, currmove, (isQuiet ? -80 * depth : -25 * depth * depth)))
+            {
+                STATS_ADD(worker, StatSeePruning);
                 continue;
+            }
         }
 
         // Report currmove info if enough time has passed.
@@ -544,7 +575,6 @@ __main_loop:
             fflush(stdout);
         }
 
-        boardstack_t stack;
         score_t score = -NO_SCORE;
         int R;
         int extension = 0;
@@ -562,16 +592,22 @@ __main_loop:
                 score_t singularBeta = ttScore - depth;
                 int singularDepth = depth / 2;
 
+                STATS_ADD(worker, StatSingularTry);
                 ss->excludedMove = ttMove;
                 score_t singularScore =
                     search(board, singularDepth, singularBeta - 1, singularBeta, ss, false);
                 ss->excludedMove = NO_MOVE;
 
                 if (singularScore < singularBeta)
+                {
+                    STATS_ADD(worker, StatSingularExtension);
                     extension = 1;
-
+                }
                 else if (singularBeta >= beta)
+                {
+                    STATS_ADD(worker, StatMultiCut);
                     return (singularBeta);
+                }
             }
             else if (givesCheck)
                 extension = 1;
@@ -580,7 +616,7 @@ __main_loop:
         ss->currentMove = currmove;
         ss->pieceHistory = &worker->ctHistory[piece_on(board, from_sq(currmove))][to_sq(currmove)];
 
-        do_move_gc(board, currmove, &stack, givesCheck);
+        do_move_gc(board, currmove, givesCheck);
 
         // Can we apply LMR ?
 
@@ -610,7 +646,13 @@ __main_loop:
         else
             R = 0;
 
-        if (R) score = -search(board, newDepth - R, -alpha - 1, -alpha, ss + 1, false);
+        if (R)
+        {
+            STATS_ADD(worker, StatLmrSearch);
+            score = -search(board, newDepth - R, -alpha - 1, -alpha, ss + 1, false);
+
+            if (score > alpha) STATS_ADD(worker, StatLmrResearch);
+        }
 
         // If LMR is not possible, or our LMR failed, do a search with no reductions.
 
@@ -657,6 +699,9 @@ __main_loop:
 
                 if (alpha >= beta)
                 {
+                    STATS_ADD(worker, StatFailHigh);
+                    if (moveCount == 1) STATS_ADD(worker, StatFailHighFirst);
+
                     if (isQuiet)
                         update_quiet_history(board, depth, bestmove, quiets, qcount, ss);
                     else if (moveCount != 1)
@@ -697,7 +742,7 @@ score_t qsearch(board_t *board, score_t alpha, score_t beta, searchstack_t *ss,
     movepick_t mp;
     move_t pv[256];
 
-    if (!worker->idx) check_time();
+    if (!worker->idx) check_node_limit();
 
     if (pvNode && worker->seldepth < ss->plies + 1) worker->seldepth = ss->plies + 1;
 
@@ -718,12 +763,16 @@ score_t qsearch(board_t *board, score_t alpha, score_t beta, searchstack_t *ss,
     score_t ttScore = NO_SCORE;
     int ttBound = NO_BOUND;
     bool found;
-    tt_entry_t *entry = tt_probe(board->stack->boardKey, &found);
+    tt_entry_t ttData;
+    tt_entry_t *entry = tt_probe(board->stack->boardKey, &found, &ttData);
+
+    worker->ttProbes++;
+    worker->ttHits += found;
 
     if (found)
     {
-        ttBound = entry->genbound & 3;
-        ttScore = score_from_tt(entry->score, ss->plies);
+        ttBound = ttData.genbound & 3;
+        ttScore = score_from_tt(ttData.score, ss->plies);
 
         if (!pvNode
             && (((ttBound & LOWER_BOUND) && ttScore >= beta)
@@ -744,12 +793,12 @@ score_t qsearch(board_t *board, score_t alpha, score_t beta, searchstack_t *ss,
     {
         if (found)
         {
-            eval = bestScore = entry->eval;
+            eval = bestScore = ttData.eval;
 
             if (ttBound & (ttScore > eval ? LOWER_BOUND : UPPER_BOUND)) bestScore = ttScore;
         }
         else
-            eval = bestScore = evaluate(board);
+            eval = bestScore = evaluate_cached(board);
 
         // If not playing a capture is better because of better quiet moves,
         // allow for a simple eval return.
@@ -758,7 +807,7 @@ score_t qsearch(board_t *board, score_t alpha, score_t beta, searchstack_t *ss,
         if (alpha >= beta) return (alpha);
     }
 
-    move_t ttMove = entry->bestmove;
+    move_t ttMove = ttData.bestmove;
 
     (ss + 1)->plies = ss->plies + 1;
 
@@ -781,8 +830,6 @@ score_t qsearch(board_t *board, score_t alpha, score_t beta, searchstack_t *ss,
 
         if (bestScore > -MATE_FOUND && mp.stage == PICK_BAD_INSTABLE) break;
 
-        if (!move_is_legal(board, currmove)) continue;
-
         moveCount++;
 
         bool givesCheck = move_gives_check(board, currmove);
@@ -803,11 +850,9 @@ score_t qsearch(board_t *board, score_t alpha, score_t beta, searchstack_t *ss,
             ss->pieceHistory = &worker->ctHistory[piece_on(board, to)][to];
         }
 
-        boardstack_t stack;
-
         if (pvNode) pv[0] = NO_MOVE;
 
-        do_move_gc(board, currmove, &stack, givesCheck);
+        do_move_gc(board, currmove, givesCheck);
         score_t score = -qsearch(board, -beta, -alpha, ss + 1, pvNode);
         undo_move(board, currmove);
 
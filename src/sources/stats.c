@@ -0,0 +1,95 @@
+/*
+**    Stash, a UCI chess playing engine developed from scratch
+**    Copyright (C) 2019-2022 Morgan Houppin
+**
+**    Stash is free software: you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation, either version 3 of the License, or
+**    (at your option) any later version.
+**
+**    Stash is distributed in the hope that it will be useful,
+**    but WITHOUT ANY WARRANTY; without even the implied warranty of
+**    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**    GNU General Public License for more details.
+**
+**    You should have received a copy of the GNU General Public License
+**    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stats.h"
+#include "uci.h"
+#include <stdio.h>
+
+#ifdef STATS
+
+search_stats_t SearchStats;
+
+void wpool_merge_stats(worker_pool_t *wpool)
+{
+    for (size_t i = 0; i < wpool->size; ++i)
+    {
+        const worker_t *worker = wpool->workerList[i];
+
+        for (int s = 0; s < STAT_NB; ++s) SearchStats.counters[s] += worker->stats.counters[s];
+
+        SearchStats.nodes += worker->nodes;
+        SearchStats.ttProbes += worker->ttProbes;
+        SearchStats.ttHits += worker->ttHits;
+        SearchStats.evalProbes += worker->evalProbes;
+        SearchStats.evalHits += worker->evalHits;
+        SearchStats.pawnProbes += worker->pawnProbes;
+        SearchStats.pawnHits += worker->pawnHits;
+    }
+}
+
+void stats_reset(void) { memset(&SearchStats, 0, sizeof(search_stats_t)); }
+
+// Prints a statistics line with a counter and its ratio to the given total.
+static void print_stat(const char *name, uint64_t count, uint64_t total)
+{
+    printf("%-28s %12" FMT_INFO " / %12" FMT_INFO " (%6.2f%%)\n", name, (info_t)count,
+        (info_t)total, count * 100.0 / (total + !total));
+}
+
+void stats_print(void)
+{
+    const uint64_t *c = SearchStats.counters;
+    const uint64_t nodes = SearchStats.nodes;
+
+    printf("Search statistics:\n");
+    printf("%-28s %12" FMT_INFO "\n", "Nodes", (info_t)nodes);
+    print_stat("TT hits / probes", SearchStats.ttHits, SearchStats.ttProbes);
+    print_stat("TT cutoffs / probes", c[StatTTCutoff], SearchStats.ttProbes);
+    print_stat("Eval cache hits / probes", SearchStats.evalHits, SearchStats.evalProbes);
+    print_stat("Pawn hash hits / probes", SearchStats.pawnHits, SearchStats.pawnProbes);
+    print_stat("Razoring / nodes", c[StatRazoring], nodes);
+    print_stat("Futility (node) / nodes", c[StatFutilityNode], nodes);
+    print_stat("Null move cutoffs / tries", c[StatNullMoveCutoff], c[StatNullMoveTry]);
+    print_stat("LMP / nodes", c[StatLateMovePruning], nodes);
+    print_stat("Futility (move) / nodes", c[StatFutilityMove], nodes);
+    print_stat("SEE prunes / nodes", c[StatSeePruning], nodes);
+    print_stat("SEE calls / nodes", c[StatSeeCall], nodes);
+    print_stat("LMR re-searches / LMR", c[StatLmrResearch], c[StatLmrSearch]);
+    print_stat("Singular ext. / tries", c[StatSingularExtension], c[StatSingularTry]);
+    print_stat("Multi-cuts / tries", c[StatMultiCut], c[StatSingularTry]);
+    print_stat("First move fail highs", c[StatFailHighFirst], c[StatFailHigh]);
+    fflush(stdout);
+}
+
+void uci_stats(const char *args)
+{
+    if (args && strstr(args, "reset"))
+        stats_reset();
+    else
+        stats_print();
+}
+
+#else
+
+void uci_stats(const char *args __attribute__((unused)))
+{
+    puts("info string Search statistics are disabled, build with 'make stats=yes'");
+    fflush(stdout);
+}
+
+#endif
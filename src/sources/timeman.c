@@ -21,6 +21,8 @@
 #include "types.h"
 #include "worker.h"
 #include <math.h>
+#include <pthread.h>
+#include <stdio.h>
 
 // Scaling table based on the move type
 
@@ -115,6 +117,7 @@ void timeman_update(timeman_t *tm, const board_t *board, move_t bestmove, score_
         movelist_t list;
         bool isQuiet = !is_capture_or_promotion(board, bestmove);
         bool givesCheck = move_gives_check(board, bestmove);
+        score_t see = see_value(board, bestmove);
 
         tm->prevBestmove = bestmove;
         tm->stability = 0;
@@ -128,16 +131,16 @@ void timeman_update(timeman_t *tm, const board_t *board, move_t bestmove, score_
         else if (move_type(bestmove) == PROMOTION)
             tm->type = Promotion;
 
-        else if (!isQuiet && see_greater_than(board, bestmove, KNIGHT_MG_SCORE))
+        else if (!isQuiet && see >= KNIGHT_MG_SCORE)
             tm->type = SoundCapture;
 
-        else if (givesCheck && see_greater_than(board, bestmove, 0))
+        else if (givesCheck && see >= 0)
             tm->type = SoundCheck;
 
         else if (!isQuiet)
             tm->type = Capture;
 
-        else if (see_greater_than(board, bestmove, 0))
+        else if (see >= 0)
             tm->type = Quiet;
 
         else if (givesCheck)
@@ -169,25 +172,81 @@ void timeman_update(timeman_t *tm, const board_t *board, move_t bestmove, score_
     tm->optimalTime = min(tm->maximalTime, tm->averageTime * scale);
 }
 
-void check_time(void)
+static pthread_t TimerThread;
+static bool TimerRunning = false;
+
+// Sleeps for the given number of milliseconds.
+static void sleep_ms(clock_t ms)
 {
-    if (--WPool.checks > 0) return;
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
 
-    // Reset check counter.
+    nanosleep(&ts, NULL);
+}
 
-    WPool.checks = 1000;
+static void *timer_entry(void *nothing)
+{
+    (void)nothing;
+
+    while (!WPool.stop)
+    {
+        clock_t now = chess_clock();
 
-    // If we are in infinite mode, or the stop has already been set,
-    // we can safely return.
+        // If we are in infinite mode, only a "stop" command can end the search.
 
-    if (SearchParams.infinite || WPool.stop) return;
+        if (!SearchParams.infinite)
+        {
+            // Node counts are only summed here for multi-threaded searches. With a
+            // single worker, the search checks its own counter to stay deterministic.
+
+            if (timeman_must_stop_search(&Timeman, now)
+                || (WPool.size > 1 && wpool_get_total_nodes(&WPool) >= SearchParams.nodes))
+            {
+                WPool.stop = true;
+                break;
+            }
+        }
+
+        // Sleep until the next period, or until the deadline if it comes first.
+
+        clock_t wait = TimerPeriod;
 
-    if (wpool_get_total_nodes(&WPool) >= SearchParams.nodes) goto __set_stop;
+        if (Timeman.mode != NoTimeman)
+            wait = clamp(Timeman.start + Timeman.maximalTime - now, 1, TimerPeriod);
 
-    if (timeman_must_stop_search(&Timeman, chess_clock())) goto __set_stop;
+        sleep_ms(wait);
+    }
+
+    return (NULL);
+}
 
-    return;
+void timer_start(void)
+{
+    if (pthread_create(&TimerThread, NULL, &timer_entry, NULL))
+    {
+        perror("Unable to start timer");
+        exit(EXIT_FAILURE);
+    }
+
+    TimerRunning = true;
+}
+
+void timer_stop(void)
+{
+    if (!TimerRunning) return;
+
+    pthread_join(TimerThread, NULL);
+    TimerRunning = false;
+}
+
+void check_node_limit(void)
+{
+    if (--WPool.checks > 0) return;
+
+    // Reset check counter.
+
+    WPool.checks = 1000;
 
-__set_stop:
-    WPool.stop = true;
+    if (WPool.size == 1 && !SearchParams.infinite
+        && wpool_main_worker(&WPool)->nodes >= SearchParams.nodes)
+        WPool.stop = true;
 }
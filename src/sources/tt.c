@@ -17,44 +17,83 @@
 */
 
 #include "tt.h"
+#include "numa.h"
 #include "uci.h"
+#include <errno.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-transposition_t TT = {0, NULL, 0};
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#endif
+
+enum
+{
+    HugePageSize = 2 * 1024 * 1024,
+    TTFileVersion = 1,
+
+    // The table is stored right after the header in TT files. We pad the
+    // header to 64KB so that the table can be mapped directly with all
+    // common page sizes.
+    TTFileHeaderSize = 65536
+};
+
+// Struct for the header of TT files
+typedef struct tt_file_header_s
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t clusterSize;
+    uint64_t clusterCount;
+    uint8_t generation;
+    uint64_t epoch;
+} tt_file_header_t;
+
+static const char TTFileMagic[8] = "STASHTT";
+
+transposition_t TT = {0, NULL, 0, 0, 0, TTAllocNone, 0, 1};
 
 typedef struct tt_thread_s
 {
     size_t start;
     size_t end;
     pthread_t thread;
+    int fd;
+    int error;
+    size_t count;
 } tt_thread_t;
 
-void *tt_bzero_thread(void *data)
-{
-    tt_thread_t *threadData = data;
-    const tt_entry_t zeroEntry = {0, NO_SCORE, NO_SCORE, 0, 0, NO_MOVE};
-
-    for (size_t i = threadData->start; i < threadData->end; ++i)
-        for (size_t j = 0; j < ClusterSize; ++j) TT.table[i].clEntry[j] = zeroEntry;
-
-    return (NULL);
-}
-
-void tt_bzero(size_t threadCount)
+// Splits the TT in threadCount cluster ranges, and runs the given routine on each of them in
+// parallel. Returns the first error reported by a routine, or 0. If count is not NULL, it receives
+// the sum of the counts reported by the routines.
+static int tt_run_threads(
+    size_t threadCount, void *(*routine)(void *), int fd, size_t *count, const char *what)
 {
     if (threadCount == 0)
     {
-        fputs("Unable to zero TT: thread count equals zero\n", stderr);
+        fprintf(stderr, "%s: thread count equals zero\n", what);
         exit(EXIT_FAILURE);
     }
 
     tt_thread_t *threadList = malloc(sizeof(tt_thread_t) * threadCount);
+    int error = 0;
 
     if (threadList == NULL)
     {
-        perror("Unable to zero TT");
+        perror(what);
         exit(EXIT_FAILURE);
     }
 
@@ -62,20 +101,62 @@ void tt_bzero(size_t threadCount)
     {
         threadList[i].start = TT.clusterCount * i / threadCount;
         threadList[i].end = TT.clusterCount * (i + 1) / threadCount;
+        threadList[i].fd = fd;
+        threadList[i].error = 0;
+        threadList[i].count = 0;
     }
 
     for (size_t i = 1; i < threadCount; ++i)
-        if (pthread_create(&threadList[i].thread, NULL, &tt_bzero_thread, &threadList[i]))
+        if (pthread_create(&threadList[i].thread, NULL, routine, &threadList[i]))
         {
-            perror("Unable to zero TT");
+            perror(what);
             exit(EXIT_FAILURE);
         }
 
-    tt_bzero_thread(&threadList[0]);
+    routine(&threadList[0]);
 
     for (size_t i = 1; i < threadCount; ++i) pthread_join(threadList[i].thread, NULL);
 
+    for (size_t i = 0; i < threadCount && !error; ++i) error = threadList[i].error;
+
+    if (count != NULL)
+    {
+        *count = 0;
+        for (size_t i = 0; i < threadCount; ++i) *count += threadList[i].count;
+    }
+
     free(threadList);
+    return (error);
+}
+
+void *tt_bzero_thread(void *data)
+{
+    tt_thread_t *threadData = data;
+    tt_entry_t zeroEntry = {.score = NO_SCORE, .eval = NO_SCORE, .bestmove = NO_MOVE};
+
+    zeroEntry.key = tt_stored_key(0, zeroEntry.data);
+
+    for (size_t i = threadData->start; i < threadData->end; ++i)
+        for (size_t j = 0; j < ClusterSize; ++j) TT.table[i].clEntry[j] = zeroEntry;
+
+    return (NULL);
+}
+
+void tt_bzero(size_t threadCount)
+{
+    tt_run_threads(threadCount, &tt_bzero_thread, -1, NULL, "Unable to zero TT");
+}
+
+void tt_new_epoch(void)
+{
+    // Entries from previous epochs now decode to unrelated keys, so they
+    // can't be hit anymore, and are overwritten as the search needs room.
+    // Moving the generation half a cycle away makes them the first
+    // candidates for replacement, and keeps them out of tt_hashfull().
+
+    TT.epoch++;
+    TT.epochKey = tt_epoch_key(TT.epoch);
+    TT.generation += 128;
 }
 
 int tt_hashfull(void)
@@ -89,12 +170,270 @@ int tt_hashfull(void)
     return (count / ClusterSize);
 }
 
-void tt_resize(size_t mbsize)
+#ifdef __linux__
+
+// Checks if the kernel will honor MADV_HUGEPAGE requests.
+static bool thp_available(void)
 {
-    if (TT.table) free(TT.table);
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    char buf[128];
+    bool available = false;
+
+    if (f == NULL) return (false);
+
+    if (fgets(buf, sizeof(buf), f) != NULL) available = (strstr(buf, "[never]") == NULL);
+
+    fclose(f);
+    return (available);
+}
+
+// Spreads the pages of the given memory area over all online NUMA nodes. This must be called
+// before the memory is touched for the first time.
+static int tt_interleave(void *ptr, size_t size)
+{
+    unsigned long mask = numa_online_mask();
+    int nodes = popcount(mask);
+
+    if (nodes <= 1) return (1);
+
+    if (syscall(SYS_mbind, ptr, size, MPOL_INTERLEAVE, &mask, sizeof(mask) * 8 + 1, 0))
+        return (1);
+
+    return (nodes);
+}
+
+#endif
+
+static void *tt_alloc(size_t size)
+{
+    void *ptr = NULL;
+
+    TT.numaNodes = 1;
+
+#ifdef __linux__
+    // Round the size up to a multiple of the huge page size, so that the
+    // table is entirely covered by huge pages.
+
+    size = (size + HugePageSize - 1) / HugePageSize * HugePageSize;
+
+    // Try transparent huge pages first. They don't need any reserved memory,
+    // and gracefully fall back to 4K pages if the kernel can't find
+    // contiguous physical memory.
+
+    if (thp_available())
+    {
+        ptr = aligned_alloc(HugePageSize, size);
+
+        if (ptr != NULL && !madvise(ptr, size, MADV_HUGEPAGE))
+            TT.allocMode = TTAllocTransparentHuge;
+        else if (ptr != NULL)
+            TT.allocMode = TTAllocDefault;
+    }
+
+    // Then try explicit huge pages, which need pages reserved in the hugetlbfs pool.
+
+    if (ptr == NULL)
+    {
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+            -1, 0);
+
+        if (ptr == MAP_FAILED)
+            ptr = NULL;
+        else
+            TT.allocMode = TTAllocHugetlb;
+    }
+
+    if (ptr == NULL)
+    {
+        ptr = aligned_alloc(HugePageSize, size);
+        TT.allocMode = TTAllocDefault;
+    }
+
+    if (ptr != NULL) TT.numaNodes = tt_interleave(ptr, size);
+
+#else
+    ptr = malloc(size);
+    TT.allocMode = TTAllocDefault;
+#endif
+
+    TT.allocSize = size;
+    return (ptr);
+}
+
+static void tt_free(transposition_t *tt)
+{
+    if (tt->table == NULL) return;
+
+#ifdef __linux__
+    if (tt->allocMode == TTAllocHugetlb || tt->allocMode == TTAllocMapped)
+        munmap(tt->table, tt->allocSize);
+    else
+#endif
+        free(tt->table);
+
+    tt->table = NULL;
+    tt->allocMode = TTAllocNone;
+    tt->allocSize = 0;
+}
+
+const char *tt_alloc_info(void)
+{
+    static char buf[128];
+    const char *mode = (TT.allocMode == TTAllocTransparentHuge) ? "transparent huge pages"
+                       : (TT.allocMode == TTAllocHugetlb)       ? "hugetlbfs pages"
+                       : (TT.allocMode == TTAllocMapped)        ? "a memory-mapped file"
+                                                                : "default pages";
+
+    if (TT.numaNodes > 1)
+        sprintf(buf, "%s, interleaved over %d NUMA nodes", mode, TT.numaNodes);
+    else
+        sprintf(buf, "%s", mode);
+
+    return (buf);
+}
+
+// Returns the replacement priority of the given entry. Entries with the lowest
+// priority in a cluster are replaced first.
+INLINED int tt_entry_value(const tt_entry_t *entry)
+{
+    return (entry->depth - ((259 + TT.generation - entry->genbound) & 0xFC));
+}
+
+// Returns the smallest hashkey mapped to the given cluster index, for a table
+// with the given cluster count.
+static uint64_t tt_first_key(size_t index, size_t clusterCount)
+{
+    uint64_t lo = 0;
+    uint64_t hi = UINT64_MAX;
+
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+
+        if (mul_hi64(mid, clusterCount) >= index)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return (lo);
+}
+
+// Table being rehashed into the TT by tt_rehash_thread().
+static transposition_t RehashSource;
+
+void *tt_rehash_thread(void *data)
+{
+    tt_thread_t *threadData = data;
+    const size_t srcCount = RehashSource.clusterCount;
+
+    // Each thread owns a range of clusters of the new table, so that no
+    // locking is needed. Since the cluster index grows with the hashkey in
+    // both tables, the matching entries all come from a contiguous range of
+    // clusters of the old table.
+
+    const size_t srcStart = mul_hi64(tt_first_key(threadData->start, TT.clusterCount), srcCount);
+    size_t srcEnd = srcCount;
+
+    if (threadData->end != TT.clusterCount)
+        srcEnd = mul_hi64(tt_first_key(threadData->end, TT.clusterCount) - 1, srcCount) + 1;
+
+#ifdef TT_COMPACT
+    // Compact entries only store the low bits of their key, so we rely on the
+    // hashkey range of each old cluster to find their new cluster. Entries of
+    // old clusters overlapping two new clusters are dropped.
+
+    const uint64_t step = UINT64_MAX / srcCount;
+    uint64_t firstKey = tt_first_key(srcStart, srcCount);
+#endif
+
+    for (size_t i = srcStart; i < srcEnd; ++i)
+    {
+        const tt_entry_t *srcEntry = RehashSource.table[i].clEntry;
+
+#ifdef TT_COMPACT
+        uint64_t nextKey = firstKey;
+
+        if (i + 1 < srcCount)
+        {
+            nextKey = firstKey + step;
+            while (mul_hi64(nextKey - 1, srcCount) > i) --nextKey;
+            while (mul_hi64(nextKey, srcCount) <= i) ++nextKey;
+        }
+
+        const size_t dst = mul_hi64(firstKey, TT.clusterCount);
+        const bool mapped = (i + 1 == srcCount) ? dst == TT.clusterCount - 1
+                                                : dst == mul_hi64(nextKey - 1, TT.clusterCount);
+
+        firstKey = nextKey;
+
+        if (!mapped) continue;
+#endif
+
+        for (int j = 0; j < ClusterSize; ++j)
+        {
+            const tt_entry_t *cur = srcEntry + j;
+            const ttkey_t curKey = tt_entry_key(cur);
+
+            // Skip empty entries, and the ones old enough to be leftovers
+            // from a previous epoch.
+
+            if (!curKey || ((259 + TT.generation - cur->genbound) & 0xFC) >= 128) continue;
+
+#ifndef TT_COMPACT
+            // Entries whose key doesn't match their cluster are torn or stale.
+
+            if (mul_hi64(curKey, srcCount) != i) continue;
 
+            const size_t dst = mul_hi64(curKey, TT.clusterCount);
+#endif
+
+            if (dst < threadData->start || dst >= threadData->end) continue;
+
+            tt_entry_t *entry = TT.table[dst].clEntry;
+            tt_entry_t *replace = entry;
+
+            for (int k = 0; k < ClusterSize; ++k)
+            {
+                if (!tt_entry_key(entry + k))
+                {
+                    replace = entry + k;
+                    break;
+                }
+
+                if (tt_entry_value(replace) > tt_entry_value(entry + k)) replace = entry + k;
+            }
+
+            if (!tt_entry_key(replace))
+                threadData->count++;
+            else if (tt_entry_value(replace) >= tt_entry_value(cur))
+                continue;
+
+            *replace = *cur;
+        }
+    }
+
+    return (NULL);
+}
+
+size_t tt_resize(size_t mbsize)
+{
+    size_t retained = 0;
+
+    // Keep the old table around while the new one is filled.
+
+    RehashSource = TT;
+    TT.table = NULL;
     TT.clusterCount = mbsize * 1024 * 1024 / sizeof(cluster_t);
-    TT.table = malloc(TT.clusterCount * sizeof(cluster_t));
+    TT.table = tt_alloc(TT.clusterCount * sizeof(cluster_t));
+
+    // If both tables don't fit in memory, give up on the old contents.
+
+    if (TT.table == NULL && RehashSource.table != NULL)
+    {
+        tt_free(&RehashSource);
+        TT.table = tt_alloc(TT.clusterCount * sizeof(cluster_t));
+    }
 
     if (TT.table == NULL)
     {
@@ -103,43 +442,280 @@ void tt_resize(size_t mbsize)
     }
 
     tt_bzero((size_t)Options.threads);
+
+    if (RehashSource.table != NULL)
+    {
+        tt_run_threads((size_t)Options.threads, &tt_rehash_thread, -1, &retained,
+            "Unable to resize TT");
+        tt_free(&RehashSource);
+    }
+
+    return (retained);
 }
 
-tt_entry_t *tt_probe(hashkey_t key, bool *found)
+tt_entry_t *tt_probe(hashkey_t key, bool *found, tt_entry_t *ttData)
 {
     tt_entry_t *entry = tt_entry_at(key);
+    const ttkey_t ttKey = tt_key(key);
 
     for (int i = 0; i < ClusterSize; ++i)
-        if (!entry[i].key || entry[i].key == key)
+    {
+        // Work on a local copy of the entry, since other threads might be
+        // writing to it at the same time.
+
+        tt_entry_t cur = entry[i];
+        ttkey_t curKey = tt_entry_key(&cur);
+
+        if (!curKey || curKey == ttKey)
         {
-            entry[i].genbound = (uint8_t)(TT.generation | (entry[i].genbound & 0x3));
-            *found = (bool)entry[i].key;
+            cur.genbound = (uint8_t)(TT.generation | (cur.genbound & 0x3));
+            entry[i].data = cur.data;
+            entry[i].key = tt_stored_key(curKey, cur.data);
+
+            cur.key = curKey;
+            *ttData = cur;
+            *found = (bool)curKey;
             return (entry + i);
         }
+    }
 
     tt_entry_t *replace = entry;
 
     for (int i = 1; i < ClusterSize; ++i)
-        if (replace->depth - ((259 + TT.generation - replace->genbound) & 0xFC)
-            > entry[i].depth - ((259 + TT.generation - entry[i].genbound) & 0xFC))
-            replace = entry + i;
+        if (tt_entry_value(replace) > tt_entry_value(entry + i)) replace = entry + i;
 
+    *ttData = *replace;
+    ttData->key = tt_entry_key(ttData);
     *found = false;
     return (replace);
 }
 
 void tt_save(tt_entry_t *entry, hashkey_t k, score_t s, score_t e, int d, int b, move_t m)
 {
-    if (m || k != entry->key) entry->bestmove = (uint16_t)m;
+    tt_entry_t cur = *entry;
+    ttkey_t curKey = tt_entry_key(&cur);
+    const ttkey_t ttKey = tt_key(k);
+
+    if (m || ttKey != curKey) cur.bestmove = (uint16_t)m;
 
     // Do not erase entries with higher depth for same position.
 
-    if (b == EXACT_BOUND || k != entry->key || d + 4 >= entry->depth)
+    if (b == EXACT_BOUND || ttKey != curKey || d + 4 >= cur.depth)
+    {
+        curKey = ttKey;
+        cur.score = s;
+        cur.eval = e;
+        cur.genbound = TT.generation | (uint8_t)b;
+        cur.depth = d;
+    }
+
+    // Readers mixing the old and new halves of the entry will fail the key
+    // check, so no locking is needed here.
+
+    entry->data = cur.data;
+    entry->key = tt_stored_key(curKey, cur.data);
+}
+
+// Fills the header of a TT file for the current table.
+static void tt_fill_header(tt_file_header_t *header)
+{
+    memset(header, 0, sizeof(tt_file_header_t));
+    memcpy(header->magic, TTFileMagic, sizeof(TTFileMagic));
+    header->version = TTFileVersion;
+    header->clusterSize = sizeof(cluster_t);
+    header->clusterCount = TT.clusterCount;
+    header->generation = TT.generation;
+    header->epoch = TT.epoch;
+}
+
+// Checks that the header of a TT file matches the current TT layout.
+static const char *tt_check_header(const tt_file_header_t *header)
+{
+    if (memcmp(header->magic, TTFileMagic, sizeof(TTFileMagic)))
+        return ("not a hash file");
+
+    if (header->version != TTFileVersion) return ("unsupported hash file version");
+
+    if (header->clusterSize != sizeof(cluster_t))
+        return ("hash file was saved with a different TT layout");
+
+    if (header->clusterCount == 0) return ("empty hash file");
+
+    return (NULL);
+}
+
+#ifdef __linux__
+
+void *tt_save_file_thread(void *data)
+{
+    tt_thread_t *threadData = data;
+    const char *ptr = (const char *)(TT.table + threadData->start);
+    size_t size = (threadData->end - threadData->start) * sizeof(cluster_t);
+    off_t offset = TTFileHeaderSize + (off_t)(threadData->start * sizeof(cluster_t));
+
+    while (size)
+    {
+        ssize_t written = pwrite(threadData->fd, ptr, size, offset);
+
+        if (written <= 0)
+        {
+            threadData->error = written ? errno : EIO;
+            break;
+        }
+
+        ptr += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+
+    return (NULL);
+}
+
+const char *tt_save_file(const char *filename, size_t threadCount)
+{
+    static char header[TTFileHeaderSize];
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int error = 0;
+
+    if (fd < 0) return (strerror(errno));
+
+    tt_fill_header((tt_file_header_t *)header);
+
+    if (pwrite(fd, header, TTFileHeaderSize, 0) != TTFileHeaderSize)
+        error = errno ? errno : EIO;
+
+    // Each thread writes its own range of clusters at the matching file
+    // offset, the same way tt_bzero() splits the table.
+
+    if (!error) error = tt_run_threads(
+            threadCount, &tt_save_file_thread, fd, NULL, "Unable to save TT");
+
+    if (close(fd) && !error) error = errno;
+
+    return (error ? strerror(error) : NULL);
+}
+
+const char *tt_load_file(const char *filename)
+{
+    tt_file_header_t header;
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) return (strerror(errno));
+
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
     {
-        entry->key = k;
-        entry->score = s;
-        entry->eval = e;
-        entry->genbound = TT.generation | (uint8_t)b;
-        entry->depth = d;
+        close(fd);
+        return ("truncated hash file");
     }
+
+    const char *error = tt_check_header(&header);
+    size_t size = header.clusterCount * sizeof(cluster_t);
+
+    if (!error && (fstat(fd, &st) || (size_t)st.st_size < TTFileHeaderSize + size))
+        error = "truncated hash file";
+
+    if (error)
+    {
+        close(fd);
+        return (error);
+    }
+
+    // Map the table privately, so that the search can write to it without
+    // modifying the file, and pages are only read from disk when touched.
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, TTFileHeaderSize);
+
+    close(fd);
+
+    if (ptr == MAP_FAILED) return (strerror(errno));
+
+    madvise(ptr, size, MADV_WILLNEED);
+
+    tt_free(&TT);
+    TT.table = ptr;
+    TT.clusterCount = header.clusterCount;
+    TT.generation = header.generation;
+    TT.epoch = header.epoch;
+    TT.epochKey = tt_epoch_key(TT.epoch);
+    TT.allocMode = TTAllocMapped;
+    TT.allocSize = size;
+    TT.numaNodes = 1;
+    return (NULL);
 }
+
+#else
+
+const char *tt_save_file(const char *filename, size_t threadCount)
+{
+    static char header[TTFileHeaderSize];
+    FILE *f = fopen(filename, "wb");
+    bool ok;
+
+    (void)threadCount;
+
+    if (f == NULL) return (strerror(errno));
+
+    tt_fill_header((tt_file_header_t *)header);
+
+    ok = fwrite(header, TTFileHeaderSize, 1, f) == 1
+         && fwrite(TT.table, sizeof(cluster_t), TT.clusterCount, f) == TT.clusterCount;
+
+    if (fclose(f)) ok = false;
+
+    return (ok ? NULL : strerror(errno));
+}
+
+const char *tt_load_file(const char *filename)
+{
+    tt_file_header_t header;
+    FILE *f = fopen(filename, "rb");
+
+    if (f == NULL) return (strerror(errno));
+
+    if (fread(&header, sizeof(header), 1, f) != 1)
+    {
+        fclose(f);
+        return ("truncated hash file");
+    }
+
+    const char *error = tt_check_header(&header);
+
+    if (!error && fseek(f, TTFileHeaderSize, SEEK_SET)) error = "truncated hash file";
+
+    if (error)
+    {
+        fclose(f);
+        return (error);
+    }
+
+    tt_free(&TT);
+    TT.clusterCount = header.clusterCount;
+    TT.table = tt_alloc(TT.clusterCount * sizeof(cluster_t));
+
+    if (TT.table == NULL)
+    {
+        perror("Failed to allocate hashtable");
+        exit(EXIT_FAILURE);
+    }
+
+    if (fread(TT.table, sizeof(cluster_t), TT.clusterCount, f) != TT.clusterCount)
+        error = "truncated hash file";
+
+    fclose(f);
+
+    // Don't keep a partially loaded table around.
+
+    if (error)
+        tt_bzero((size_t)Options.threads);
+    else
+    {
+        TT.generation = header.generation;
+        TT.epoch = header.epoch;
+        TT.epochKey = tt_epoch_key(TT.epoch);
+    }
+
+    return (error);
+}
+
+#endif
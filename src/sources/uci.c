@@ -20,6 +20,8 @@
 #include "evaluate.h"
 #include "movelist.h"
 #include "option.h"
+#include "search.h"
+#include "timeman.h"
 #include "tt.h"
 #include "types.h"
 #include <ctype.h>
@@ -38,10 +40,13 @@ const cmdlink_t commands[] =
     {"d", &uci_d},
     {"go", &uci_go},
     {"isready", &uci_isready},
+    {"loadhash", &uci_loadhash},
     {"ponderhit", &uci_ponderhit},
     {"position", &uci_position},
     {"quit", &uci_quit},
+    {"savehash", &uci_savehash},
     {"setoption", &uci_setoption},
+    {"stats", &uci_stats},
     {"stop", &uci_stop},
     {"uci", &uci_uci},
     {"ucinewgame", &uci_ucinewgame},
@@ -55,6 +60,13 @@ const char *BoundStr[] = {
     ""
 };
 
+const char *const HelperScheduleNames[SCHEDULE_NB + 1] = {
+    "Uniform",
+    "Skip",
+    "Offset",
+    NULL
+};
+
 // clang-format on
 
 // Finds the next token in the given string, writes a nullbyte to its end,
@@ -168,11 +180,11 @@ void uci_isready(const char *args __attribute__((unused)))
     fflush(stdout);
 }
 
-void uci_quit(const char *args __attribute__((unused))) { WPool.stop = true; }
+void uci_quit(const char *args __attribute__((unused))) { wpool_stop(&WPool); }
 
-void uci_stop(const char *args __attribute__((unused))) { WPool.stop = true; }
+void uci_stop(const char *args __attribute__((unused))) { wpool_stop(&WPool); }
 
-void uci_ponderhit(const char *args __attribute__((unused))) { WPool.ponder = false; }
+void uci_ponderhit(const char *args __attribute__((unused))) { wpool_ponderhit(&WPool); }
 
 void uci_uci(const char *args __attribute__((unused)))
 {
@@ -187,7 +199,7 @@ void uci_ucinewgame(const char *args)
 {
     (void)args;
     worker_wait_search_end(wpool_main_worker(&WPool));
-    tt_bzero((size_t)Options.threads);
+    tt_new_epoch();
     wpool_reset(&WPool);
 }
 
@@ -219,18 +231,8 @@ void uci_d(const char *args __attribute__((unused)))
 
 void uci_position(const char *args)
 {
-    static boardstack_t **hiddenList = NULL;
-    static size_t hiddenSize = 0;
-
-    if (hiddenSize > 0)
-    {
-        for (size_t i = 0; i < hiddenSize; ++i) free(hiddenList[i]);
-        free(hiddenList);
-    }
-
-    hiddenList = malloc(sizeof(boardstack_t *));
-    *hiddenList = malloc(sizeof(boardstack_t));
-    hiddenSize = 1;
+    static boardstack_t *stackList = NULL;
+    static size_t stackListSize = 0;
 
     char *fen;
     char *copy = strdup(args);
@@ -262,7 +264,28 @@ void uci_position(const char *args)
     else
         return;
 
-    set_board(&Board, fen, Options.chess960, *hiddenList);
+    // The board history is kept in a contiguous array. There is at most one move per
+    // token, and one spare frame is kept for probing the children of the final position.
+
+    size_t frames = 2;
+
+    for (const char *c = args; *c; ++c) frames += (strchr(Delimiters, *c) != NULL);
+
+    if (frames > stackListSize)
+    {
+        free(stackList);
+        stackList = malloc(sizeof(boardstack_t) * frames);
+
+        if (stackList == NULL)
+        {
+            perror("Unable to allocate board history");
+            exit(EXIT_FAILURE);
+        }
+
+        stackListSize = frames;
+    }
+
+    set_board(&Board, fen, Options.chess960, stackList);
     Board.worker = wpool_main_worker(&WPool);
     free(fen);
     token = get_next_token(&ptr);
@@ -271,10 +294,7 @@ void uci_position(const char *args)
 
     while (token && (move = str_to_move(&Board, token)) != NO_MOVE)
     {
-        hiddenList = realloc(hiddenList, sizeof(boardstack_t *) * ++hiddenSize);
-        hiddenList[hiddenSize - 1] = malloc(sizeof(boardstack_t));
-
-        do_move(&Board, move, hiddenList[hiddenSize - 1]);
+        do_move(&Board, move);
         token = get_next_token(&ptr);
     }
 
@@ -350,8 +370,10 @@ void uci_go(const char *args)
         else if (strcmp(token, "perft") == 0)
         {
             token = strtok(NULL, Delimiters);
-            if (token) SearchParams.perft = atoi(token);
+            if (token) SearchParams.perft = clamp(atoi(token), 0, MAX_PLIES);
         }
+        else if (strcmp(token, "divide") == 0)
+            SearchParams.divide = 1;
         else if (strcmp(token, "movetime") == 0)
         {
             token = strtok(NULL, Delimiters);
@@ -444,20 +466,184 @@ int execute_uci_cmd(const char *command)
     return (1);
 }
 
+// Returns a copy of the given command arguments, without surrounding whitespace.
+
+static char *get_filename(const char *args)
+{
+    if (!args) return (NULL);
+
+    while (isspace(*args)) ++args;
+
+    char *filename = strdup(args);
+    size_t len = strlen(filename);
+
+    while (len && isspace(filename[len - 1])) filename[--len] = '\0';
+
+    if (!len)
+    {
+        free(filename);
+        return (NULL);
+    }
+    return (filename);
+}
+
+void uci_savehash(const char *args)
+{
+    char *filename = get_filename(args);
+
+    if (!filename)
+    {
+        puts("info string Usage: savehash <file>");
+        fflush(stdout);
+        return;
+    }
+
+    worker_wait_search_end(wpool_main_worker(&WPool));
+
+    const char *error = tt_save_file(filename, (size_t)Options.threads);
+
+    if (error)
+        printf("info string Unable to save hash to %s: %s\n", filename, error);
+    else
+        printf("info string saved hash to %s\n", filename);
+
+    fflush(stdout);
+    free(filename);
+}
+
+void uci_loadhash(const char *args)
+{
+    char *filename = get_filename(args);
+
+    if (!filename)
+    {
+        puts("info string Usage: loadhash <file>");
+        fflush(stdout);
+        return;
+    }
+
+    worker_wait_search_end(wpool_main_worker(&WPool));
+
+    const char *error = tt_load_file(filename);
+
+    if (error)
+        printf("info string Unable to load hash from %s: %s\n", filename, error);
+    else
+        printf("info string loaded hash from %s (%lu MB)\n", filename,
+            (unsigned long)(TT.clusterCount * sizeof(cluster_t) / (1024 * 1024)));
+
+    fflush(stdout);
+    free(filename);
+}
+
 void on_hash_set(void *data)
 {
-    tt_resize((size_t) * (long *)data);
+    clock_t start = chess_clock();
+    size_t retained = tt_resize((size_t) * (long *)data);
+
     printf("info string set Hash to %lu MB\n", *(long *)data);
+    printf("info string Hash allocated with %s\n", tt_alloc_info());
+    printf("info string kept %" FMT_INFO " entries in %" FMT_INFO " ms\n", (info_t)retained,
+        (info_t)(chess_clock() - start));
     fflush(stdout);
 }
 
 void on_clear_hash(void *nothing __attribute__((unused)))
 {
-    tt_bzero((size_t)Options.threads);
+    tt_new_epoch();
     puts("info string cleared hash");
     fflush(stdout);
 }
 
+void on_eval_file_set(void *data)
+{
+    const char *filename = *(char **)data;
+
+    if (!strcmp(filename, "") || !strcmp(filename, "<empty>"))
+    {
+        nnue_unload();
+        puts("info string using classical evaluation");
+    }
+    else
+    {
+        const char *error = nnue_load(filename);
+
+        if (error)
+            printf("info string unable to load network %s: %s, using classical evaluation\n",
+                filename, error);
+        else
+            printf("info string loaded network %s\n", filename);
+    }
+
+    // Cached evals from the previous backend are no longer valid.
+
+    wpool_reset(&WPool);
+    fflush(stdout);
+}
+
+// Returns the index of the given value in a NULL-terminated list of combo values, or -1 if not
+// found.
+
+static int combo_index(const char *const *comboList, const char *value)
+{
+    for (int i = 0; comboList[i]; ++i)
+        if (!strcmp(comboList[i], value)) return (i);
+
+    return (-1);
+}
+
+void on_helper_schedule_set(void *data)
+{
+    const char *name = *(char **)data;
+    int i = combo_index(HelperScheduleNames, name);
+
+    if (i < 0)
+        printf("info string unknown Helper Schedule %s\n", name);
+    else
+    {
+        Options.helperSchedule = (helper_schedule_t)i;
+        printf("info string set Helper Schedule to %s\n", name);
+    }
+    fflush(stdout);
+}
+
+void on_thread_binding_set(void *data)
+{
+    const char *name = *(char **)data;
+    int i = combo_index(ThreadBindingNames, name);
+
+    if (i < 0)
+        printf("info string unknown Thread Binding %s\n", name);
+    else
+    {
+        // Restart the workers, so that they bind themselves and reallocate
+        // their tables with the new policy.
+
+        Options.threadBinding = (thread_binding_t)i;
+        wpool_init(&WPool, (size_t)Options.threads);
+        printf("info string set Thread Binding to %s\n", name);
+    }
+    fflush(stdout);
+}
+
+void on_eval_cache_set(void *data)
+{
+    // The workers allocate their eval cache when starting.
+
+    wpool_init(&WPool, (size_t)Options.threads);
+    printf("info string set Eval Cache to %lu MB\n", *(long *)data);
+    fflush(stdout);
+}
+
+void on_pawn_hash_set(void *data)
+{
+    // The workers allocate their pawn table when starting.
+
+    wpool_init(&WPool, (size_t)Options.threads);
+    printf("info string set Pawn Hash to %lu MB\n", *(long *)data);
+    fflush(stdout);
+}
+
 void on_thread_set(void *data)
 {
     wpool_init(&WPool, (unsigned long)*(long *)data);
@@ -467,14 +653,34 @@ void on_thread_set(void *data)
 
 void uci_loop(int argc, char **argv)
 {
+    // Combo options need their value to be allocated, since they free it on change.
+
+    char *helperSchedule = strdup(HelperScheduleNames[Options.helperSchedule]);
+    char *threadBinding = strdup(ThreadBindingNames[Options.threadBinding]);
+    char *evalFile = strdup("<empty>");
+
+    if (helperSchedule == NULL || threadBinding == NULL || evalFile == NULL)
+    {
+        perror("Unable to allocate option");
+        exit(EXIT_FAILURE);
+    }
+
     init_option_list(&OptionList);
     add_option_spin_int(&OptionList, "Threads", &Options.threads, 1, 256, &on_thread_set);
     add_option_spin_int(&OptionList, "Hash", &Options.hash, 1, MAX_HASH, &on_hash_set);
+    add_option_spin_int(
+        &OptionList, "Eval Cache", &Options.evalCache, 1, 1024, &on_eval_cache_set);
+    add_option_spin_int(&OptionList, "Pawn Hash", &Options.pawnHash, 1, 1024, &on_pawn_hash_set);
     add_option_spin_int(&OptionList, "Move Overhead", &Options.moveOverhead, 0, 30000, NULL);
     add_option_spin_int(&OptionList, "MultiPV", &Options.multiPv, 1, 500, NULL);
     add_option_check(&OptionList, "UCI_Chess960", &Options.chess960, NULL);
     add_option_check(&OptionList, "Ponder", &Options.ponder, NULL);
+    add_option_combo(&OptionList, "Helper Schedule", &helperSchedule, HelperScheduleNames,
+        &on_helper_schedule_set);
+    add_option_combo(
+        &OptionList, "Thread Binding", &threadBinding, ThreadBindingNames, &on_thread_binding_set);
     add_option_button(&OptionList, "Clear Hash", &on_clear_hash);
+    add_option_string(&OptionList, "EvalFile", &evalFile, &on_eval_file_set);
 
     uci_position("startpos");
 
@@ -1,10 +1,15 @@
 #include "worker.h"
 #include "movelist.h"
+#include "numa.h"
+#include "search.h"
 #include "uci.h"
 #include <stdio.h>
 #include <string.h>
 
-worker_pool_t WPool;
+worker_pool_t WPool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .condVar = PTHREAD_COND_INITIALIZER,
+};
 
 INLINED int rtm_greater_than(root_move_t *right, root_move_t *left)
 {
@@ -47,17 +52,13 @@ root_move_t *find_root_move(root_move_t *begin, root_move_t *end, move_t move)
 void worker_init(worker_t *worker, size_t idx)
 {
     worker->idx = idx;
-    worker->stack = NULL;
-    worker->pawnTable = calloc(PawnTableSize, sizeof(pawn_entry_t));
+    worker->stackList = NULL;
+    worker->pawnTable = NULL;
+    worker->materialTable = NULL;
+    worker->evalCache = NULL;
     worker->exit = false;
     worker->searching = true;
 
-    if (worker->pawnTable == NULL)
-    {
-        perror("Unable to allocate pawn table");
-        exit(EXIT_FAILURE);
-    }
-
     if (pthread_mutex_init(&worker->mutex, NULL) || pthread_cond_init(&worker->condVar, NULL))
     {
         perror("Unable to initialize worker lock");
@@ -82,7 +83,10 @@ void worker_destroy(worker_t *worker)
         exit(EXIT_FAILURE);
     }
 
-    free(worker->pawnTable);
+    numa_free(worker->stackList, sizeof(boardstack_t) * worker->stackListSize);
+    numa_free(worker->pawnTable, sizeof(pawn_entry_t) * worker->pawnTableSize);
+    numa_free(worker->materialTable, sizeof(material_entry_t) * MaterialTableSize);
+    numa_free(worker->evalCache, sizeof(eval_entry_t) * worker->evalCacheSize);
     pthread_mutex_destroy(&worker->mutex);
     pthread_cond_destroy(&worker->condVar);
 }
@@ -93,6 +97,7 @@ void worker_reset(worker_t *worker)
     memset(worker->ctHistory, 0, sizeof(continuation_history_t));
     memset(worker->cmHistory, 0, sizeof(countermove_history_t));
     memset(worker->capHistory, 0, sizeof(capture_history_t));
+    memset(worker->evalCache, 0, sizeof(eval_entry_t) * worker->evalCacheSize);
     worker->verifPlies = 0;
 }
 
@@ -115,6 +120,44 @@ void *worker_entry(void *ptr)
 {
     worker_t *worker = ptr;
 
+    // Bind the thread before allocating and touching the worker's tables, so
+    // that they get placed on the thread's NUMA node.
+
+    numa_bind_thread(Options.threadBinding, worker->idx);
+
+    // The board history of the worker is a contiguous array of stack frames, covering the
+    // plies before the root needed for repetition detection and the search plies.
+
+    worker->stackListSize = DefaultHistorySize + MAX_PLIES + 2;
+    worker->stackList = numa_alloc(sizeof(boardstack_t) * worker->stackListSize);
+
+    if (worker->stackList == NULL)
+    {
+        perror("Unable to allocate board history");
+        exit(EXIT_FAILURE);
+    }
+
+    worker->pawnTableSize = (size_t)Options.pawnHash * 1024 * 1024 / sizeof(pawn_entry_t);
+    worker->pawnTable = numa_alloc(sizeof(pawn_entry_t) * worker->pawnTableSize);
+    worker->materialTable = numa_alloc(sizeof(material_entry_t) * MaterialTableSize);
+
+    if (worker->pawnTable == NULL || worker->materialTable == NULL)
+    {
+        perror("Unable to allocate pawn and material tables");
+        exit(EXIT_FAILURE);
+    }
+
+    worker->evalCacheSize = (size_t)Options.evalCache * 1024 * 1024 / sizeof(eval_entry_t);
+    worker->evalCache = numa_alloc(sizeof(eval_entry_t) * worker->evalCacheSize);
+
+    if (worker->evalCache == NULL)
+    {
+        perror("Unable to allocate eval cache");
+        exit(EXIT_FAILURE);
+    }
+
+    worker_reset(worker);
+
     while (true)
     {
         pthread_mutex_lock(&worker->mutex);
@@ -149,7 +192,7 @@ void wpool_init(worker_pool_t *wpool, size_t threads)
             worker_t *curWorker = wpool->workerList[wpool->size];
 
             worker_destroy(curWorker);
-            free(curWorker);
+            numa_free(curWorker, sizeof(worker_t));
         }
 
         free(wpool->workerList);
@@ -167,7 +210,10 @@ void wpool_init(worker_pool_t *wpool, size_t threads)
 
         while (wpool->size < threads)
         {
-            wpool->workerList[wpool->size] = malloc(sizeof(worker_t));
+            // The worker is allocated untouched, and first written to by its
+            // own thread when it resets its histories.
+
+            wpool->workerList[wpool->size] = numa_alloc(sizeof(worker_t));
 
             if (wpool->workerList[wpool->size] == NULL)
             {
@@ -179,6 +225,10 @@ void wpool_init(worker_pool_t *wpool, size_t threads)
             wpool->size++;
         }
 
+        // Wait for all workers to be ready before touching their data.
+
+        for (size_t i = 0; i < wpool->size; ++i) worker_wait_search_end(wpool->workerList[i]);
+
         wpool_reset(wpool);
     }
 }
@@ -198,13 +248,37 @@ void wpool_start_search(
     wpool->stop = false;
     wpool->ponder = searchParams->ponder;
 
+    const size_t history = boardstack_history(rootBoard->stack);
+    const size_t frames = history + MAX_PLIES + 2;
+
     for (size_t i = 0; i < wpool->size; ++i)
     {
         worker_t *curWorker = wpool->workerList[i];
 
         curWorker->nodes = 0;
+        curWorker->ttProbes = curWorker->ttHits = 0;
+        curWorker->evalProbes = curWorker->evalHits = 0;
+        curWorker->pawnProbes = curWorker->pawnHits = 0;
+        STATS_RESET(curWorker);
+
+        // Positions with a long reversible history might not fit in the preallocated
+        // board history.
+
+        if (curWorker->stackListSize < frames)
+        {
+            numa_free(curWorker->stackList, sizeof(boardstack_t) * curWorker->stackListSize);
+            curWorker->stackListSize = frames;
+            curWorker->stackList = numa_alloc(sizeof(boardstack_t) * frames);
+
+            if (curWorker->stackList == NULL)
+            {
+                perror("Unable to allocate board history");
+                exit(EXIT_FAILURE);
+            }
+        }
+
         curWorker->board = *rootBoard;
-        curWorker->stack = curWorker->board.stack = dup_boardstack(rootBoard->stack);
+        curWorker->board.stack = copy_boardstack(curWorker->stackList, rootBoard->stack, history);
         curWorker->board.worker = curWorker;
         curWorker->rootCount = movelist_size(&SearchMoves);
         curWorker->rootMoves = malloc(sizeof(root_move_t) * curWorker->rootCount);
@@ -239,6 +313,32 @@ void wpool_wait_search_end(worker_pool_t *wpool)
     for (size_t i = 1; i < wpool->size; ++i) worker_wait_search_end(wpool->workerList[i]);
 }
 
+void wpool_stop(worker_pool_t *wpool)
+{
+    pthread_mutex_lock(&wpool->mutex);
+    wpool->stop = true;
+    pthread_cond_broadcast(&wpool->condVar);
+    pthread_mutex_unlock(&wpool->mutex);
+}
+
+void wpool_ponderhit(worker_pool_t *wpool)
+{
+    pthread_mutex_lock(&wpool->mutex);
+    wpool->ponder = false;
+    pthread_cond_broadcast(&wpool->condVar);
+    pthread_mutex_unlock(&wpool->mutex);
+}
+
+void wpool_wait_stop(worker_pool_t *wpool, const goparams_t *searchParams)
+{
+    pthread_mutex_lock(&wpool->mutex);
+
+    while (!wpool->stop && (wpool->ponder || searchParams->infinite))
+        pthread_cond_wait(&wpool->condVar, &wpool->mutex);
+
+    pthread_mutex_unlock(&wpool->mutex);
+}
+
 uint64_t wpool_get_total_nodes(worker_pool_t *wpool)
 {
     uint64_t totalNodes = 0;
@@ -247,3 +347,57 @@ uint64_t wpool_get_total_nodes(worker_pool_t *wpool)
 
     return (totalNodes);
 }
+
+uint64_t wpool_get_total_tt_probes(worker_pool_t *wpool)
+{
+    uint64_t totalProbes = 0;
+
+    for (size_t i = 0; i < wpool->size; ++i) totalProbes += wpool->workerList[i]->ttProbes;
+
+    return (totalProbes);
+}
+
+uint64_t wpool_get_total_tt_hits(worker_pool_t *wpool)
+{
+    uint64_t totalHits = 0;
+
+    for (size_t i = 0; i < wpool->size; ++i) totalHits += wpool->workerList[i]->ttHits;
+
+    return (totalHits);
+}
+
+uint64_t wpool_get_total_eval_probes(worker_pool_t *wpool)
+{
+    uint64_t totalProbes = 0;
+
+    for (size_t i = 0; i < wpool->size; ++i) totalProbes += wpool->workerList[i]->evalProbes;
+
+    return (totalProbes);
+}
+
+uint64_t wpool_get_total_eval_hits(worker_pool_t *wpool)
+{
+    uint64_t totalHits = 0;
+
+    for (size_t i = 0; i < wpool->size; ++i) totalHits += wpool->workerList[i]->evalHits;
+
+    return (totalHits);
+}
+
+uint64_t wpool_get_total_pawn_probes(worker_pool_t *wpool)
+{
+    uint64_t totalProbes = 0;
+
+    for (size_t i = 0; i < wpool->size; ++i) totalProbes += wpool->workerList[i]->pawnProbes;
+
+    return (totalProbes);
+}
+
+uint64_t wpool_get_total_pawn_hits(worker_pool_t *wpool)
+{
+    uint64_t totalHits = 0;
+
+    for (size_t i = 0; i < wpool->size; ++i) totalHits += wpool->workerList[i]->pawnHits;
+
+    return (totalHits);
+}